@@ -139,6 +139,9 @@ void HandlerTimerPoweroff(void *ctx)
         uint32_t lastRx = TimerGetMillis() - context->ibus->rxLastStamp;
         if (lastRx >= HANDLER_POWER_TIMEOUT_MILLIS) {
             if (context->powerStatus == HANDLER_POWER_ON) {
+                // Commit the pending configuration writes before the
+                // regulator can drop out from under us
+                ConfigFlush();
                 // Destroy the UART module for IBus
                 UARTDestroy(IBUS_UART_MODULE);
                 TimerDelayMicroseconds(500);
@@ -126,7 +126,7 @@ void HandlerBTInit(HandlerContext_t *context)
         context->avrcpRegisterStatusNotifierTimerId = TimerRegisterScheduledTask(
             &HandlerTimerBTBM83AVRCPManager,
             context,
-            HANDLER_INT_BT_AVRCP_UPDATER
+            HANDLER_INT_BT_AVRCP_FALLBACK
         );
         context->bm83PowerStateTimerId = TimerRegisterScheduledTask(
             &HandlerTimerBTBM83ManagePowerState,
@@ -141,6 +141,52 @@ void HandlerBTInit(HandlerContext_t *context)
     );
 }
 
+/**
+ * HandlerBTBM83AVRCPGetNotifications()
+ *     Description:
+ *         Get the AVRCP events to register for. Playback status and track
+ *         changes are mandatory for AVRCP 1.3 targets, so they are used even
+ *         if the capabilities are unknown. Position, volume and track
+ *         boundary events are not registered since we do not act on them,
+ *         and position changes would flood the UART.
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *     Returns:
+ *         uint16_t - One bit per AVRCP event ID
+ */
+static uint16_t HandlerBTBM83AVRCPGetNotifications(BT_t *bt)
+{
+    uint16_t events = HANDLER_BT_AVRCP_NOTIFICATIONS_MANDATORY;
+    if (bt->activeDevice.avrcpCaps.nowPlayingChanged == 1) {
+        events |= 1 << BM83_AVRCP_EVT_NOW_PLAYING_CONTENT_CHANGED;
+    }
+    if (bt->activeDevice.avrcpCaps.addressedPlayerChanged == 1) {
+        events |= 1 << BM83_AVRCP_EVT_ADDRESSED_PLAYER_CHANGED;
+    }
+    return events;
+}
+
+/**
+ * HandlerBTBM83AVRCPStart()
+ *     Description:
+ *         Request the AVRCP capabilities and metadata of a newly connected
+ *         device and register for its notifications
+ *     Params:
+ *         HandlerContext_t *context - The handler context
+ *     Returns:
+ *         void
+ */
+static void HandlerBTBM83AVRCPStart(HandlerContext_t *context)
+{
+    BT_t *bt = context->bt;
+    bt->avrcpNotifications = HandlerBTBM83AVRCPGetNotifications(bt);
+    bt->avrcpNotificationsArmed = 0;
+    bt->avrcpUpdates = SET_BIT(bt->avrcpUpdates, BT_AVRCP_ACTION_GET_CAPABILITIES);
+    bt->avrcpUpdates = SET_BIT(bt->avrcpUpdates, BT_AVRCP_ACTION_GET_METADATA);
+    bt->avrcpUpdates = SET_BIT(bt->avrcpUpdates, BT_AVRCP_ACTION_REGISTER_NOTIFICATIONS);
+    TimerTriggerScheduledTask(context->avrcpRegisterStatusNotifierTimerId);
+}
+
 /**
  * HandlerBTCallStatus()
  *     Description:
@@ -436,6 +482,11 @@ void HandlerBTDeviceLinkConnected(void *ctx, uint8_t *data)
             ) {
                 BTCommandPlay(context->bt);
             }
+            if (context->bt->type == BT_BTM_TYPE_BM83 &&
+                linkType == BT_LINK_TYPE_AVRCP
+            ) {
+                HandlerBTBM83AVRCPStart(context);
+            }
             if (context->bt->type == BT_BTM_TYPE_BM83) {
                 // Request Device Name if it is empty
                 char tmp[BT_DEVICE_NAME_LEN] = {0};
@@ -542,15 +593,7 @@ void HandlerBTPlaybackStatus(void *ctx, uint8_t *data)
                 BTCommandGetMetadata(context->bt);
             }
         } else {
-            context->bt->avrcpUpdates = SET_BIT(
-                context->bt->avrcpUpdates,
-                BT_AVRCP_ACTION_GET_METADATA
-            );
-            context->bt->avrcpUpdates = SET_BIT(
-                context->bt->avrcpUpdates,
-                BT_AVRCP_ACTION_SET_TRACK_CHANGE_NOTIF
-            );
-            TimerResetScheduledTask(context->avrcpRegisterStatusNotifierTimerId);
+            HandlerBTBM83AVRCPStart(context);
         }
         context->btStartupIsRun = 1;
     }
@@ -653,47 +696,67 @@ void HandlerBTBC127BootStatus(void *ctx, uint8_t *tmp)
 /**
  * HandlerBTBM83AVRCPUpdates()
  *     Description:
- *         Handle AVRCP updates
+ *         Handle AVRCP updates. Notifications are registered for again as
+ *         soon as they fire, and the metadata is requested right away when
+ *         the track changes.
  *     Params:
  *         void *ctx - The context provided at registration
- *         uint8_t *data - Any event data
+ *         uint8_t *data - The event or PDU ID, the response code and the
+ *             notification value
  *     Returns:
  *         void
  */
 void HandlerBTBM83AVRCPUpdates(void *ctx, uint8_t *data)
 {
     HandlerContext_t *context = (HandlerContext_t *) ctx;
+    BT_t *bt = context->bt;
     uint8_t type = data[0];
-    uint8_t status = data[1];
-    if ((type == BM83_AVRCP_EVT_PLAYBACK_STATUS_CHANGED &&
-        status == BM83_AVRCP_DATA_PLAYBACK_STATUS_PLAYING) ||
-        type == BM83_AVRCP_EVT_ADDRESSED_PLAYER_CHANGED
-    ) {
-        context->bt->avrcpUpdates = SET_BIT(
-            context->bt->avrcpUpdates,
-            BT_AVRCP_ACTION_SET_TRACK_CHANGE_NOTIF
+    uint8_t response = data[1];
+    uint8_t status = data[2];
+    if (type == BM83_AVRCP_PDU_GET_CAPABILITIES) {
+        // The mandatory notifications were registered for on connection
+        bt->avrcpNotifications |= HandlerBTBM83AVRCPGetNotifications(bt) &
+            ~HANDLER_BT_AVRCP_NOTIFICATIONS_MANDATORY;
+        bt->avrcpUpdates = SET_BIT(
+            bt->avrcpUpdates,
+            BT_AVRCP_ACTION_REGISTER_NOTIFICATIONS
         );
-        if (status == BM83_AVRCP_DATA_PLAYBACK_STATUS_PLAYING) {
-            context->bt->avrcpUpdates = SET_BIT(
-                context->bt->avrcpUpdates,
-                BT_AVRCP_ACTION_GET_METADATA
-            );
+    } else if (type >= BT_AVRCP_EVENT_COUNT) {
+        return;
+    } else if (response == BM83_DATA_AVC_RSP_INTERIM) {
+        bt->avrcpNotificationsArmed |= 1 << type;
+    } else if (response == BM83_DATA_AVC_RSP_CHANGED) {
+        // A notification only fires once, so register for the next one
+        bt->avrcpNotificationsArmed &= ~(1 << type);
+        bt->avrcpNotifications |= 1 << type;
+        bt->avrcpUpdates = SET_BIT(
+            bt->avrcpUpdates,
+            BT_AVRCP_ACTION_REGISTER_NOTIFICATIONS
+        );
+        if (type == BM83_AVRCP_EVT_ADDRESSED_PLAYER_CHANGED) {
+            // Registrations do not carry over to the new player
+            bt->avrcpNotifications = HandlerBTBM83AVRCPGetNotifications(bt);
+            bt->avrcpNotificationsArmed = 0;
         }
-        TimerResetScheduledTask(context->avrcpRegisterStatusNotifierTimerId);
-    } else if (type == BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED) {
-        // On AVRCP "Change"
-        if (status != BM83_DATA_AVC_RSP_INTERIM) {
-            context->bt->avrcpUpdates = SET_BIT(
-                context->bt->avrcpUpdates,
-                BT_AVRCP_ACTION_SET_TRACK_CHANGE_NOTIF
-            );
-            context->bt->avrcpUpdates = SET_BIT(
-                context->bt->avrcpUpdates,
+        if (type == BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED ||
+            type == BM83_AVRCP_EVT_NOW_PLAYING_CONTENT_CHANGED ||
+            type == BM83_AVRCP_EVT_ADDRESSED_PLAYER_CHANGED ||
+            (type == BM83_AVRCP_EVT_PLAYBACK_STATUS_CHANGED &&
+            status == BM83_AVRCP_DATA_PLAYBACK_STATUS_PLAYING &&
+            CHECK_BIT(
+                bt->avrcpNotificationsArmed,
+                BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED
+            ) == 0)
+        ) {
+            bt->avrcpUpdates = SET_BIT(
+                bt->avrcpUpdates,
                 BT_AVRCP_ACTION_GET_METADATA
             );
-            TimerResetScheduledTask(context->avrcpRegisterStatusNotifierTimerId);
         }
     }
+    if (bt->avrcpUpdates != 0x00) {
+        TimerTriggerScheduledTask(context->avrcpRegisterStatusNotifierTimerId);
+    }
 }
 
 /**
@@ -911,15 +974,23 @@ void HandlerTimerBTBC127State(void *ctx)
 void HandlerTimerBTBC127DeviceConnection(void *ctx)
 {
     HandlerContext_t *context = (HandlerContext_t *) ctx;
+    uint8_t tag = BC127_CMD_TAG_PROFILE_OPEN + BC127_LINK_A2DP;
     if (BTHasActiveMacId(context->bt) != 0 && context->bt->activeDevice.a2dpId == 0) {
+        if (BC127CommandQueueHasTag(tag) == 1) {
+            // Wait for the outcome of the last attempt
+            return;
+        }
         if (context->btDeviceConnRetries <= HANDLER_DEVICE_MAX_RECONN) {
             LogDebug(
                 LOG_SOURCE_SYSTEM,
                 "Handler: A2DP link closed -- Attempting to connect"
             );
-            BC127CommandProfileOpen(
+            BC127CommandProfileOpenCallback(
                 context->bt,
-                "A2DP"
+                "A2DP",
+                tag,
+                &HandlerBTBC127DeviceConnectionResult,
+                context
             );
             context->btDeviceConnRetries += 1;
         } else {
@@ -933,6 +1004,29 @@ void HandlerTimerBTBC127DeviceConnection(void *ctx)
     }
 }
 
+/**
+ * HandlerBTBC127DeviceConnectionResult()
+ *     Description:
+ *         Reset the reconnection attempts once the A2DP profile opened
+ *     Params:
+ *         void *ctx - The context provided at registration
+ *         BC127CommandResult_t *result - The outcome of the OPEN command
+ *     Returns:
+ *         void
+ */
+void HandlerBTBC127DeviceConnectionResult(void *ctx, BC127CommandResult_t *result)
+{
+    HandlerContext_t *context = (HandlerContext_t *) ctx;
+    if (result->result == BC127_CMD_RESULT_OK) {
+        LogDebug(
+            LOG_SOURCE_SYSTEM,
+            "Handler: A2DP link opened in %u ms",
+            result->latency
+        );
+        context->btDeviceConnRetries = 0;
+    }
+}
+
 /**
  * HandlerTimerBTBC127RequestDateTime()
  *     Description:
@@ -963,11 +1057,18 @@ void HandlerTimerBTBC127OpenProfileErrors(void *ctx)
     HandlerContext_t *context = (HandlerContext_t *) ctx;
     if (BTHasActiveMacId(context->bt) != 0) {
         for (uint8_t idx = 0; idx < BC127_PROFILE_COUNT; idx++) {
-            if (context->bt->pairingErrors[idx] == 1 && PROFILES[idx] != 0) {
+            uint8_t tag = BC127_CMD_TAG_PROFILE_OPEN + idx;
+            if (context->bt->pairingErrors[idx] == 1 &&
+                PROFILES[idx] != 0 &&
+                BC127CommandQueueHasTag(tag) == 0
+            ) {
                 LogDebug(LOG_SOURCE_SYSTEM, "Handler: Attempting to resolve pairing error");
-                BC127CommandProfileOpen(
+                BC127CommandProfileOpenCallback(
                     context->bt,
-                    PROFILES[idx]
+                    PROFILES[idx],
+                    tag,
+                    &HandlerBTBC127OpenProfileResult,
+                    context
                 );
                 context->bt->pairingErrors[idx] = 0;
             }
@@ -975,6 +1076,26 @@ void HandlerTimerBTBC127OpenProfileErrors(void *ctx)
     }
 }
 
+/**
+ * HandlerBTBC127OpenProfileResult()
+ *     Description:
+ *         Flag the profile for another attempt if the module never answered.
+ *         An OPEN_ERROR flags the profile when it is processed.
+ *     Params:
+ *         void *ctx - The context provided at registration
+ *         BC127CommandResult_t *result - The outcome of the OPEN command
+ *     Returns:
+ *         void
+ */
+void HandlerBTBC127OpenProfileResult(void *ctx, BC127CommandResult_t *result)
+{
+    HandlerContext_t *context = (HandlerContext_t *) ctx;
+    uint8_t profile = result->tag - BC127_CMD_TAG_PROFILE_OPEN;
+    if (result->result == BC127_CMD_RESULT_TIMEOUT && profile < BC127_PROFILE_COUNT) {
+        context->bt->pairingErrors[profile] = 1;
+    }
+}
+
 /**
  * HandlerTimerBTBC127ScanDevices()
  *     Description:
@@ -1034,7 +1155,11 @@ void HandlerTimerBTBC127Metadata(HandlerContext_t *context)
 /**
  * HandlerTimerBTBM83AVRCPManager()
  *     Description:
- *         Register the track change event notifier or grab the metadata
+ *         Send the pending AVRCP requests. Requests are made as soon as the
+ *         notifications that call for them arrive, so on its own schedule
+ *         this is only a fallback: it registers again for notifications
+ *         that were never confirmed, and polls the metadata of devices that
+ *         cannot notify us of track changes.
  *     Params:
  *         void *ctx - The context provided at registration
  *     Returns:
@@ -1043,53 +1168,82 @@ void HandlerTimerBTBC127Metadata(HandlerContext_t *context)
 void HandlerTimerBTBM83AVRCPManager(void *ctx)
 {
     HandlerContext_t *context = (HandlerContext_t *) ctx;
-    if (context->bt->avrcpUpdates != 0x00) {
-        if (CHECK_BIT(context->bt->avrcpUpdates, BT_AVRCP_ACTION_SET_TRACK_CHANGE_NOTIF) > 0) {
-            context->bt->avrcpUpdates = CLEAR_BIT(
-                context->bt->avrcpUpdates,
-                BT_AVRCP_ACTION_SET_TRACK_CHANGE_NOTIF
+    BT_t *bt = context->bt;
+    if (bt->activeDevice.avrcpId == 0) {
+        bt->avrcpUpdates = 0x00;
+        return;
+    }
+    if (bt->avrcpUpdates == 0x00) {
+        uint16_t missing = HandlerBTBM83AVRCPGetNotifications(bt) &
+            ~bt->avrcpNotificationsArmed;
+        if (missing != 0) {
+            bt->avrcpNotifications |= missing;
+            bt->avrcpUpdates = SET_BIT(
+                bt->avrcpUpdates,
+                BT_AVRCP_ACTION_REGISTER_NOTIFICATIONS
             );
-            BM83CommandAVRCPRegisterNotification(
-                context->bt,
+        }
+        if (bt->playbackStatus == BT_AVRCP_STATUS_PLAYING &&
+            CHECK_BIT(
+                bt->avrcpNotificationsArmed,
                 BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED
-            );
-        } else if (CHECK_BIT(context->bt->avrcpUpdates, BT_AVRCP_ACTION_GET_METADATA) > 0) {
-            context->bt->avrcpUpdates = CLEAR_BIT(
-                context->bt->avrcpUpdates,
+            ) == 0
+        ) {
+            bt->avrcpUpdates = SET_BIT(
+                bt->avrcpUpdates,
                 BT_AVRCP_ACTION_GET_METADATA
             );
-            BM83CommandAVRCPGetElementAttributesAll(context->bt);
         }
-        // Set the timeout to 250ms from now if we still need to get metadata
-        if (CHECK_BIT(context->bt->avrcpUpdates, BT_AVRCP_ACTION_GET_METADATA) > 0) {
-            TimerSetTaskInterval(
-                context->avrcpRegisterStatusNotifierTimerId,
-                HANDLER_INT_BT_AVRCP_UPDATER_METADATA
-            );
-        } else {
-            TimerSetTaskInterval(
-                context->avrcpRegisterStatusNotifierTimerId,
-                HANDLER_INT_BT_AVRCP_UPDATER
+    }
+    // Leave room in the command queue for commands that are not AVRCP
+    uint8_t queueLimit = BM83_CMD_QUEUE_SIZE - 2;
+    if (CHECK_BIT(bt->avrcpUpdates, BT_AVRCP_ACTION_GET_CAPABILITIES) > 0 &&
+        BM83CommandQueueGetDepth() < queueLimit
+    ) {
+        bt->avrcpUpdates = CLEAR_BIT(
+            bt->avrcpUpdates,
+            BT_AVRCP_ACTION_GET_CAPABILITIES
+        );
+        BM83CommandAVRCPGetCapabilities(bt);
+    }
+    // Ask for the metadata before registering, since it is what gets shown
+    if (CHECK_BIT(bt->avrcpUpdates, BT_AVRCP_ACTION_GET_METADATA) > 0 &&
+        BM83CommandQueueGetDepth() < queueLimit
+    ) {
+        bt->avrcpUpdates = CLEAR_BIT(
+            bt->avrcpUpdates,
+            BT_AVRCP_ACTION_GET_METADATA
+        );
+        BM83CommandAVRCPGetElementAttributesAll(bt);
+    }
+    if (CHECK_BIT(bt->avrcpUpdates, BT_AVRCP_ACTION_REGISTER_NOTIFICATIONS) > 0) {
+        uint8_t event = 0;
+        for (event = 0; event < BT_AVRCP_EVENT_COUNT; event++) {
+            if (CHECK_BIT(bt->avrcpNotifications, event) > 0 &&
+                BM83CommandQueueGetDepth() < queueLimit
+            ) {
+                bt->avrcpNotifications = CLEAR_BIT(bt->avrcpNotifications, event);
+                BM83CommandAVRCPRegisterNotification(bt, event);
+            }
+        }
+        if (bt->avrcpNotifications == 0) {
+            bt->avrcpUpdates = CLEAR_BIT(
+                bt->avrcpUpdates,
+                BT_AVRCP_ACTION_REGISTER_NOTIFICATIONS
             );
         }
     }
-}
-
-
-/**
- * HandlerTimerBTBM83AVRCPPlaybackState()
- *     Description:
- *         Request the current playback status and ensure that autplay is run
- *         correctly
- *     Params:
- *         void *ctx - The context provided at registration
- *     Returns:
- *         void
- */
-void HandlerTimerBTBM83AVRCPPlaybackState(void *ctx)
-{
-    HandlerContext_t *context = (HandlerContext_t *) ctx;
-    if (context->bt->activeDevice.avrcpId != 0) {
+    // Come back soon if the command queue held some requests back
+    if (bt->avrcpUpdates != 0x00) {
+        TimerSetTaskInterval(
+            context->avrcpRegisterStatusNotifierTimerId,
+            HANDLER_INT_BT_AVRCP_UPDATER_METADATA
+        );
+    } else {
+        TimerSetTaskInterval(
+            context->avrcpRegisterStatusNotifierTimerId,
+            HANDLER_INT_BT_AVRCP_FALLBACK
+        );
     }
 }
 
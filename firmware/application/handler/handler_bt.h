@@ -19,6 +19,10 @@
 #include "../ui/cd53.h"
 #include "../ui/mid.h"
 #include "handler_common.h"
+// AVRCP 1.3 targets have to support these notifications
+#define HANDLER_BT_AVRCP_NOTIFICATIONS_MANDATORY \
+    ((1 << BM83_AVRCP_EVT_PLAYBACK_STATUS_CHANGED) | \
+    (1 << BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED))
 
 void HandlerBTInit(HandlerContext_t *);
 void HandlerBTCallStatus(void *, uint8_t *);
@@ -33,6 +37,8 @@ void HandlerUIInitiateConnection(void *, uint8_t *);
 
 void HandlerBTBC127Boot(void *, uint8_t *);
 void HandlerBTBC127BootStatus(void *, uint8_t *);
+void HandlerBTBC127DeviceConnectionResult(void *, BC127CommandResult_t *);
+void HandlerBTBC127OpenProfileResult(void *, BC127CommandResult_t *);
 
 void HandlerBTBM83AVRCPUpdates(void *, uint8_t *);
 void HandlerBTBM83Boot(void *, uint8_t *);
@@ -52,6 +52,8 @@
 #define HANDLER_INT_LIGHTING_STATE 1000
 #define HANDLER_INT_BT_AVRCP_UPDATER 1000
 #define HANDLER_INT_BT_AVRCP_UPDATER_METADATA 250
+// AVRCP notifications drive the BM83, so only check up on them occasionally
+#define HANDLER_INT_BT_AVRCP_FALLBACK 5000
 #define HANDLER_INT_PROFILE_ERROR 2500
 #define HANDLER_INT_POWEROFF 1000
 #define HANDLER_INT_VOL_MGMT 500
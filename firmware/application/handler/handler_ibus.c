@@ -704,6 +704,8 @@ void HandlerIBusIKEIgnitionStatus(void *ctx, uint8_t *pkt)
                     BT_MAC_ID_LEN
                 );
             }
+            // The module may lose power at any point from here
+            ConfigFlush();
             // Disable Telephone On and Telephone Mute
             UtilsSetPinMode(UTILS_PIN_TEL_ON, 0);
             UtilsSetPinMode(UTILS_PIN_TEL_MUTE, 0);
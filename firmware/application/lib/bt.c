@@ -26,7 +26,6 @@ BT_t BTInit()
     bt.discoverable = BT_STATE_ON;
     bt.callStatus = BT_CALL_INACTIVE;
     bt.scoStatus = BT_CALL_SCO_CLOSE;
-    bt.metadataStatus = BT_METADATA_STATUS_CUR;
     bt.vrStatus = BT_VOICE_RECOG_OFF;
     bt.pairedDevicesCount = 0;
     bt.playbackStatus = BT_AVRCP_STATUS_PAUSED;
@@ -490,4 +489,5 @@ void BTProcess(BT_t *bt)
     } else {
         BM83Process(bt);
     }
+    BTMetadataProcess(bt);
 }
\ No newline at end of file
@@ -38,6 +38,41 @@ int8_t BTBC127MicGainTable[] = {
     39 // Technically 39.5 - D6
 };
 
+static BC127Command_t BC127CommandQueue[BC127_CMD_QUEUE_SIZE];
+// The text of the queued commands, without the end character
+static CharQueue_t BC127CommandQueueText;
+static uint8_t BC127CommandQueueDepth = 0;
+static uint8_t BC127CommandQueueInFlight = 0;
+static uint8_t BC127CommandQueueWaiting = 0;
+static BC127CommandStats_t BC127CommandQueueStats;
+
+// Sorted by token length and then by name, for BC127GetEvent()
+static const BC127Event_t BC127_EVENTS[BC127_EVENT_COUNT] = {
+    BC127_EVENT("AT", BC127_EVENT_AT),
+    BC127_EVENT("OK", BC127_EVENT_OK),
+    BC127_EVENT("LINK", BC127_EVENT_LINK),
+    BC127_EVENT("LIST", BC127_EVENT_LIST),
+    BC127_EVENT("NAME", BC127_EVENT_NAME),
+    BC127_EVENT("ERROR", BC127_EVENT_ERROR),
+    BC127_EVENT("STATE", BC127_EVENT_STATE),
+    BC127_EVENT("Build:", BC127_EVENT_BUILD),
+    BC127_EVENT("ABS_VOL", BC127_EVENT_ABS_VOL),
+    BC127_EVENT("OPEN_OK", BC127_EVENT_OPEN_OK),
+    BC127_EVENT("CALL_END", BC127_EVENT_CALL_END),
+    BC127_EVENT("CLOSE_OK", BC127_EVENT_CLOSE_OK),
+    BC127_EVENT("SCO_OPEN", BC127_EVENT_SCO_OPEN),
+    BC127_EVENT("SCO_CLOSE", BC127_EVENT_SCO_CLOSE),
+    BC127_EVENT("AVRCP_PLAY", BC127_EVENT_AVRCP_PLAY),
+    BC127_EVENT("AVRCP_STOP", BC127_EVENT_AVRCP_STOP),
+    BC127_EVENT("OPEN_ERROR", BC127_EVENT_OPEN_ERROR),
+    BC127_EVENT("AVRCP_MEDIA", BC127_EVENT_AVRCP_MEDIA),
+    BC127_EVENT("AVRCP_PAUSE", BC127_EVENT_AVRCP_PAUSE),
+    BC127_EVENT("CALL_ACTIVE", BC127_EVENT_CALL_ACTIVE),
+    BC127_EVENT("CALL_INCOMING", BC127_EVENT_CALL_INCOMING),
+    BC127_EVENT("CALL_OUTGOING", BC127_EVENT_CALL_OUTGOING),
+    BC127_EVENT("A2DP_STREAM_SUSPEND", BC127_EVENT_A2DP_STREAM_SUSPEND)
+};
+
 /**
  * BC127ClearPairingErrors()
  *     Description:
@@ -427,10 +462,21 @@ void BC127CommandGetDeviceName(BT_t *bt, char *macId)
  */
 void BC127CommandGetMetadata(BT_t *bt)
 {
+    if (BC127CommandQueueHasTag(BC127_CMD_TAG_METADATA) == 1) {
+        // The previous request is still outstanding
+        return;
+    }
     if (bt->activeDevice.avrcpId != 0) {
         char command[19];
         snprintf(command, 19, "AVRCP_META_DATA %d", bt->activeDevice.avrcpId);
-        BC127SendCommand(bt, command);
+        BC127SendCommandCallback(
+            bt,
+            command,
+            BC127_EVENT_OK,
+            BC127_CMD_TAG_METADATA,
+            0,
+            0
+        );
         bt->metadataTimestamp = TimerGetMillis();
     } else {
         LogWarning("BT: Unable to get Metadata - AVRCP link unopened");
@@ -546,6 +592,384 @@ void BC127CommandProfileClose(BT_t *bt, uint8_t linkId)
     BC127SendCommand(bt, command);
 }
 
+/**
+ * BC127CommandQueueComplete()
+ *     Description:
+ *         Remove a command that is in flight from the queue, record its
+ *         latency and report the result to its callback
+ *     Params:
+ *         uint8_t position - The position of the command in the queue
+ *         uint8_t result - BC127_CMD_RESULT_OK, _ERROR or _TIMEOUT
+ *     Returns:
+ *         void
+ */
+static void BC127CommandQueueComplete(uint8_t position, uint8_t result)
+{
+    BC127Command_t command = BC127CommandQueue[position];
+    // Close the gap, the commands behind it keep their order
+    while (position < BC127CommandQueueDepth - 1) {
+        BC127CommandQueue[position] = BC127CommandQueue[position + 1];
+        position++;
+    }
+    BC127CommandQueueDepth--;
+    BC127CommandQueueInFlight--;
+    BC127CommandResult_t commandResult;
+    uint32_t latency = TimerGetMillis() - command.timestamp;
+    if (latency > 0xFFFF) {
+        latency = 0xFFFF;
+    }
+    commandResult.result = result;
+    commandResult.tag = command.tag;
+    commandResult.latency = (uint16_t) latency;
+    if (result == BC127_CMD_RESULT_TIMEOUT) {
+        BC127CommandQueueStats.timeouts++;
+    } else {
+        if (result == BC127_CMD_RESULT_ERROR) {
+            BC127CommandQueueStats.errors++;
+        }
+        BC127CommandQueueStats.completed++;
+        BC127CommandQueueStats.latencyLast = commandResult.latency;
+        BC127CommandQueueStats.latencyTotal += commandResult.latency;
+        if (commandResult.latency > BC127CommandQueueStats.latencyMax) {
+            BC127CommandQueueStats.latencyMax = commandResult.latency;
+        }
+    }
+    if (command.callback != 0) {
+        command.callback(command.context, &commandResult);
+    }
+}
+
+/**
+ * BC127CommandQueueGetDepth()
+ *     Description:
+ *         Get the number of commands that are queued or in flight
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - The number of commands
+ */
+uint8_t BC127CommandQueueGetDepth()
+{
+    return BC127CommandQueueDepth;
+}
+
+/**
+ * BC127CommandQueueGetStats()
+ *     Description:
+ *         Get the command queue counters
+ *     Params:
+ *         None
+ *     Returns:
+ *         BC127CommandStats_t * - The counters
+ */
+BC127CommandStats_t *BC127CommandQueueGetStats()
+{
+    return &BC127CommandQueueStats;
+}
+
+/**
+ * BC127CommandQueueHasTag()
+ *     Description:
+ *         Check if a command with the given tag is queued or in flight, so
+ *         that callers do not repeat requests that are still outstanding
+ *     Params:
+ *         uint8_t tag - The tag to look for
+ *     Returns:
+ *         uint8_t - 1 if there is such a command, 0 otherwise
+ */
+uint8_t BC127CommandQueueHasTag(uint8_t tag)
+{
+    uint8_t position = 0;
+    for (position = 0; position < BC127CommandQueueDepth; position++) {
+        if (BC127CommandQueue[position].tag == tag) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * BC127CommandQueueIsProfile()
+ *     Description:
+ *         Check if an OPEN_OK or OPEN_ERROR names the profile that a command
+ *         is waiting to open, so that a profile the device opened on its own
+ *         does not answer the request for another one
+ *     Params:
+ *         BC127Command_t *command - The command in flight
+ *         uint8_t event - BC127_EVENT_OPEN_OK or BC127_EVENT_OPEN_ERROR
+ *         char **msgBuf - The message buffer split into an array using spaces as the delimiter
+ *     Returns:
+ *         uint8_t - 1 if the event answers the command, 0 otherwise
+ */
+static uint8_t BC127CommandQueueIsProfile(
+    BC127Command_t *command,
+    uint8_t event,
+    char **msgBuf
+) {
+    if (command->profile[0] == '\0') {
+        return 1;
+    }
+    // OPEN_OK {link ID} {profile} {MAC ID}
+    if (event == BC127_EVENT_OPEN_OK) {
+        return strcmp(msgBuf[2], command->profile) == 0;
+    }
+    // OPEN_ERROR names the profile in either position, see
+    // BC127ProcessEventOpenError()
+    return strcmp(msgBuf[1], command->profile) == 0 ||
+        strcmp(msgBuf[2], command->profile) == 0;
+}
+
+/**
+ * BC127CommandQueueResponse()
+ *     Description:
+ *         Match an event to the oldest command in flight that it answers.
+ *         OPEN_OK and OPEN_ERROR only answer a command for the profile they
+ *         name. ERROR answers the oldest command waiting for OK, or the
+ *         oldest command if none is.
+ *     Params:
+ *         uint8_t event - The event received, see BC127_EVENT_*
+ *         char **msgBuf - The message buffer split into an array using spaces as the delimiter
+ *     Returns:
+ *         void
+ */
+static void BC127CommandQueueResponse(uint8_t event, char **msgBuf)
+{
+    uint8_t position = 0;
+    if (event == BC127_EVENT_BUILD) {
+        // The module rebooted, so nothing else in flight will be answered
+        while (BC127CommandQueueInFlight > 0) {
+            uint8_t result = BC127_CMD_RESULT_ERROR;
+            if (BC127CommandQueue[0].response == event) {
+                result = BC127_CMD_RESULT_OK;
+            }
+            BC127CommandQueueComplete(0, result);
+        }
+        return;
+    }
+    for (position = 0; position < BC127CommandQueueInFlight; position++) {
+        BC127Command_t *command = &BC127CommandQueue[position];
+        if (command->response == BC127_EVENT_OPEN_OK &&
+            (event == BC127_EVENT_OPEN_OK || event == BC127_EVENT_OPEN_ERROR)
+        ) {
+            if (BC127CommandQueueIsProfile(command, event, msgBuf) == 1) {
+                uint8_t result = BC127_CMD_RESULT_ERROR;
+                if (event == BC127_EVENT_OPEN_OK) {
+                    result = BC127_CMD_RESULT_OK;
+                }
+                BC127CommandQueueComplete(position, result);
+                return;
+            }
+        } else if (command->response == event) {
+            BC127CommandQueueComplete(position, BC127_CMD_RESULT_OK);
+            return;
+        } else if (command->response == BC127_EVENT_OK &&
+            event == BC127_EVENT_ERROR
+        ) {
+            BC127CommandQueueComplete(position, BC127_CMD_RESULT_ERROR);
+            return;
+        }
+    }
+    if (event == BC127_EVENT_ERROR && BC127CommandQueueInFlight > 0) {
+        BC127CommandQueueComplete(0, BC127_CMD_RESULT_ERROR);
+    }
+}
+
+/**
+ * BC127CommandQueueCanSend()
+ *     Description:
+ *         Check if a queued command may be sent alongside the commands in
+ *         flight. Only BC127_CMD_MAX_IN_FLIGHT commands may await OK, while
+ *         commands answered by an event only wait for one that awaits the
+ *         same event for the same profile, so that a slow OPEN does not hold
+ *         up the queue. Nothing is sent while the module is rebooting.
+ *     Params:
+ *         BC127Command_t *command - The next command to send
+ *     Returns:
+ *         uint8_t - 1 if the command may be sent, 0 otherwise
+ */
+static uint8_t BC127CommandQueueCanSend(BC127Command_t *command)
+{
+    uint8_t position = 0;
+    uint8_t awaitingOk = 0;
+    for (position = 0; position < BC127CommandQueueInFlight; position++) {
+        BC127Command_t *sent = &BC127CommandQueue[position];
+        if (sent->response == BC127_EVENT_BUILD) {
+            return 0;
+        }
+        if (sent->response == BC127_EVENT_OK) {
+            awaitingOk++;
+        } else if (sent->response == command->response &&
+            strcmp(sent->profile, command->profile) == 0
+        ) {
+            return 0;
+        }
+    }
+    if (command->response == BC127_EVENT_OK &&
+        awaitingOk >= BC127_CMD_MAX_IN_FLIGHT
+    ) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * BC127CommandQueueSend()
+ *     Description:
+ *         Send queued commands in order for as long as
+ *         BC127CommandQueueCanSend() allows it
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+static void BC127CommandQueueSend(BT_t *bt)
+{
+    while (BC127CommandQueueInFlight < BC127CommandQueueDepth &&
+        BC127CommandQueueCanSend(
+            &BC127CommandQueue[BC127CommandQueueInFlight]
+        ) == 1
+    ) {
+        BC127Command_t *command = &BC127CommandQueue[BC127CommandQueueInFlight];
+        uint16_t cmdLength = command->length + 1;
+        uint8_t data[cmdLength];
+        uint16_t i = 0;
+        for (i = 0; i < command->length; i++) {
+            data[i] = CharQueueNext(&BC127CommandQueueText);
+        }
+        data[command->length] = '\0';
+        LogDebug(LOG_SOURCE_BT, "BT: W: '%s'", data);
+        data[command->length] = BC127_MSG_END_CHAR;
+        UARTSendData(&bt->uart, data, cmdLength);
+        command->timestamp = TimerGetMillis();
+        BC127CommandQueueInFlight++;
+    }
+}
+
+/**
+ * BC127CommandQueueProcess()
+ *     Description:
+ *         Time out the commands that were not answered in time and send the
+ *         commands that are waiting
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+static void BC127CommandQueueProcess(BT_t *bt)
+{
+    uint32_t now = TimerGetMillis();
+    uint8_t position = 0;
+    while (position < BC127CommandQueueInFlight) {
+        BC127Command_t *command = &BC127CommandQueue[position];
+        uint16_t timeout = BC127_CMD_TIMEOUT_EVENT;
+        if (command->response == BC127_EVENT_OK) {
+            timeout = BC127_CMD_TIMEOUT;
+        }
+        if (now - command->timestamp >= timeout) {
+            LogWarning(
+                "BT: Command timed out waiting for event %d (Tag %d)",
+                command->response,
+                command->tag
+            );
+            BC127CommandQueueComplete(position, BC127_CMD_RESULT_TIMEOUT);
+        } else {
+            position++;
+        }
+    }
+    BC127CommandQueueSend(bt);
+}
+
+/**
+ * BC127CommandQueueIsFull()
+ *     Description:
+ *         Check if there is no room to queue a command of the given length
+ *     Params:
+ *         uint16_t cmdLength - The length of the command text
+ *     Returns:
+ *         uint8_t - 1 if the command does not fit, 0 otherwise
+ */
+static uint8_t BC127CommandQueueIsFull(uint16_t cmdLength)
+{
+    // Keep a byte free, since a full character queue reads as empty
+    if (BC127CommandQueueDepth == BC127_CMD_QUEUE_SIZE ||
+        CharQueueGetSize(&BC127CommandQueueText) + cmdLength >= CHAR_QUEUE_SIZE
+    ) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * BC127CommandQueueAdd()
+ *     Description:
+ *         Queue a command and send it as soon as BC127CommandQueueCanSend()
+ *         allows it. The command completes once the given event, an error
+ *         or the timeout occurs. If the queue is full, process the module
+ *         until a command in flight completes or times out, so that bursts
+ *         such as the one from CLI RESTORE are not dropped.
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         char *command - A command to send, with null termination included
+ *         uint8_t response - The event that answers the command
+ *         char *profile - The profile the response must name, 0 for any
+ *         uint8_t tag - Identifies the request in the callback
+ *         BC127CommandCallback_t callback - Called once the command
+ *             completes, may be 0
+ *         void *context - The context to give to the callback
+ *     Returns:
+ *         uint8_t - 1 if the command was queued, 0 if the queue is full
+ */
+static uint8_t BC127CommandQueueAdd(
+    BT_t *bt,
+    char *command,
+    uint8_t response,
+    char *profile,
+    uint8_t tag,
+    BC127CommandCallback_t callback,
+    void *context
+) {
+    uint16_t cmdLength = strlen(command);
+    // Commands only leave the queue once BC127Process() reads their response.
+    // Do not wait again if a callback queues a command while we are waiting.
+    if (BC127CommandQueueIsFull(cmdLength) == 1 &&
+        BC127CommandQueueWaiting == 0
+    ) {
+        BC127CommandQueueWaiting = 1;
+        while (BC127CommandQueueIsFull(cmdLength) == 1 &&
+            BC127CommandQueueDepth > 0
+        ) {
+            BC127Process(bt);
+        }
+        BC127CommandQueueWaiting = 0;
+    }
+    if (BC127CommandQueueIsFull(cmdLength) == 1) {
+        BC127CommandQueueStats.dropped++;
+        LogError("BT: Command queue full -- Dropping '%s'", command);
+        return 0;
+    }
+    BC127Command_t *queued = &BC127CommandQueue[BC127CommandQueueDepth];
+    uint16_t i = 0;
+    for (i = 0; i < cmdLength; i++) {
+        CharQueueAdd(&BC127CommandQueueText, command[i]);
+    }
+    queued->length = cmdLength;
+    queued->response = response;
+    queued->profile[0] = '\0';
+    if (profile != 0) {
+        UtilsStrncpy(queued->profile, profile, BC127_CMD_PROFILE_LEN);
+    }
+    queued->tag = tag;
+    queued->timestamp = 0;
+    queued->callback = callback;
+    queued->context = context;
+    BC127CommandQueueDepth++;
+    if (BC127CommandQueueDepth > BC127CommandQueueStats.peak) {
+        BC127CommandQueueStats.peak = BC127CommandQueueDepth;
+    }
+    BC127CommandQueueSend(bt);
+    return 1;
+}
+
 /**
  * BC127CommandProfileOpen()
  *     Description:
@@ -559,7 +983,38 @@ void BC127CommandProfileClose(BT_t *bt, uint8_t linkId)
  */
 void BC127CommandProfileOpen(BT_t *bt, char *profile)
 {
-     char command[24];
+    BC127CommandProfileOpenCallback(
+        bt,
+        profile,
+        BC127_CMD_TAG_NONE,
+        0,
+        0
+    );
+}
+
+/**
+ * BC127CommandProfileOpenCallback()
+ *     Description:
+ *         Open a profile for the active device and report the OPEN_OK or
+ *         OPEN_ERROR that answers it to the given callback
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         char *profile - The Profile type to open
+ *         uint8_t tag - Identifies the request in the callback
+ *         BC127CommandCallback_t callback - Called once the profile opened,
+ *             failed to open or the request timed out
+ *         void *context - The context to give to the callback
+ *     Returns:
+ *         void
+ */
+void BC127CommandProfileOpenCallback(
+    BT_t *bt,
+    char *profile,
+    uint8_t tag,
+    BC127CommandCallback_t callback,
+    void *context
+) {
+    char command[24];
     char macId[13] = {0};
     snprintf(
         macId,
@@ -574,7 +1029,15 @@ void BC127CommandProfileOpen(BT_t *bt, char *profile)
     );
     snprintf(command, 24, "OPEN %s %s", macId, profile);
     bt->status = BT_STATUS_CONNECTING;
-    BC127SendCommand(bt, command);
+    BC127CommandQueueAdd(
+        bt,
+        command,
+        BC127_EVENT_OPEN_OK,
+        profile,
+        tag,
+        callback,
+        context
+    );
 }
 
 /**
@@ -589,7 +1052,15 @@ void BC127CommandProfileOpen(BT_t *bt, char *profile)
 void BC127CommandReset(BT_t *bt)
 {
     char command[6] = "RESET";
-    BC127SendCommand(bt, command);
+    // The module answers by rebooting
+    BC127SendCommandCallback(
+        bt,
+        command,
+        BC127_EVENT_BUILD,
+        BC127_CMD_TAG_NONE,
+        0,
+        0
+    );
 }
 
 /**
@@ -1120,6 +1591,65 @@ uint8_t BC127GetDeviceId(char *str)
     return UtilsStrToInt(deviceIdStr);
 }
 
+/**
+ * BC127GetEvent()
+ *     Description:
+ *         Look up the event for the first token of a message with a binary
+ *         search over BC127_EVENTS. Tokens are compared by length first, so
+ *         most steps do not need to compare the strings at all.
+ *     Params:
+ *         const char *name - The first token of the message
+ *     Returns:
+ *         uint8_t - The event, BC127_EVENT_UNKNOWN if there is none
+ */
+uint8_t BC127GetEvent(const char *name)
+{
+    size_t length = strlen(name);
+    int8_t low = 0;
+    int8_t high = BC127_EVENT_COUNT - 1;
+    while (low <= high) {
+        int8_t mid = (low + high) / 2;
+        const BC127Event_t *event = &BC127_EVENTS[mid];
+        int16_t result = (int16_t) length - event->length;
+        if (result == 0) {
+            result = memcmp(name, event->name, length);
+        }
+        if (result == 0) {
+            return event->event;
+        }
+        if (result < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return BC127_EVENT_UNKNOWN;
+}
+
+/**
+ * BC127MessageGetRemainder()
+ *     Description:
+ *         Get the rest of the message from the given token on, with its
+ *         delimiters restored. The tokens after it are no longer terminated
+ *         afterwards.
+ *     Params:
+ *         BC127Message_t *message - The tokenized message
+ *         uint8_t token - The first token of the remainder
+ *     Returns:
+ *         char * - The remainder, an empty string if there is no such token
+ */
+char *BC127MessageGetRemainder(BC127Message_t *message, uint8_t token)
+{
+    if (token >= message->count) {
+        return message->tokens[BC127_MSG_MAX_TOKENS - 1];
+    }
+    uint8_t idx = 0;
+    for (idx = token; idx < message->count - 1; idx++) {
+        message->tokens[idx][message->lengths[idx]] = BC127_MSG_DELIMETER;
+    }
+    return message->tokens[token];
+}
+
 /**
  * BC127ProcessEventA2DPStreamSuspend()
  *     Description:
@@ -1161,38 +1691,17 @@ void BC127ProcessEventAbsVol(BT_t *bt, char **msgBuf)
  *         Process the AT event
  *     Params:
  *         BT_t *bt - A pointer to the module object
- *         char **msgBuf - The message buffer split into an array using spaces as the delimiter
- *         uint8_t delimCount - The number of spaces in the message
+ *         BC127Message_t *message - The tokenized message
  *     Returns:
  *         void
  */
-void BC127ProcessEventAT(BT_t *bt, char **msgBuf, uint8_t delimCount)
+void BC127ProcessEventAT(BT_t *bt, BC127Message_t *message)
 {
+    char **msgBuf = message->tokens;
     if (strcmp(msgBuf[3], "+CLIP:") == 0) {
         uint8_t cidDelimCounter = 0;
-        uint8_t cidDataLength = 0;
-        uint8_t msgBufSize = delimCount - 1;
-        while (msgBufSize >= 4) {
-            cidDataLength = cidDataLength + strlen(msgBuf[msgBufSize]);
-            msgBufSize--;
-        }
-        // Add index for null termination
-        cidDataLength++;
-        char cidData[cidDataLength];
-        memset(cidData, 0, sizeof(cidData));
-        uint8_t dataDelim = 4;
-        uint8_t cidDataIdx = 0;
-        uint8_t i = 0;
-        while (dataDelim < delimCount) {
-            for (i = 0; i < strlen(msgBuf[dataDelim]); i++) {
-                cidData[cidDataIdx++] = msgBuf[dataDelim][i];
-            }
-            // The space is removed when we explode the string
-            // to form msgBuf[], so add it back
-            cidData[cidDataIdx++] = 0x20;
-            dataDelim++;
-        }
-        cidData[cidDataLength - 1] = '\0';
+        // The caller ID may contain spaces, so take the rest of the message
+        char *cidData = BC127MessageGetRemainder(message, 4);
         char *cidDataBuf[6];
         memset(cidDataBuf, 0, sizeof(cidDataBuf));
         char delimeter[] = ",";
@@ -1261,7 +1770,7 @@ void BC127ProcessEventAT(BT_t *bt, char **msgBuf, uint8_t delimCount)
             i++;
         }
         // Handle AM / PM
-        if (delimCount > 6) {
+        if (message->count > 6) {
             if (UtilsStricmp(msgBuf[6], "AM") == 0) {
                 if (datetime[BC127_AT_DATE_HOUR] == 12) {
                     datetime[BC127_AT_DATE_HOUR] = 0;
@@ -1291,51 +1800,31 @@ void BC127ProcessEventAT(BT_t *bt, char **msgBuf, uint8_t delimCount)
  *         Process the AVRCP_MEDIA event
  *     Params:
  *         BT_t *bt - A pointer to the module object
- *         char **msgBuf - The message buffer split into an array using spaces as the delimiter
+ *         BC127Message_t *message - The tokenized message
  *     Returns:
  *         void
  */
-void BC127ProcessEventAVRCPMedia(BT_t *bt, char **msgBuf, char *msg)
+void BC127ProcessEventAVRCPMedia(BT_t *bt, BC127Message_t *message)
 {
+    char **msgBuf = message->tokens;
     if (strcmp(msgBuf[2], "TITLE:") == 0) {
-        char title[BT_METADATA_MAX_SIZE] = {0};
-        UtilsNormalizeText(title, &msg[BC127_METADATA_TITLE_OFFSET], BT_METADATA_MAX_SIZE);
-        if(strncmp(bt->title, title, BT_METADATA_FIELD_SIZE - 1) != 0) {
-            bt->metadataStatus = BT_METADATA_STATUS_UPD;
-            memset(bt->title, 0, BT_METADATA_FIELD_SIZE);
-            memset(bt->artist, 0, BT_METADATA_FIELD_SIZE);
-            memset(bt->album, 0, BT_METADATA_FIELD_SIZE);
-            UtilsStrncpy(bt->title, title, BT_METADATA_FIELD_SIZE);
-        }
+        BTMetadataSetField(
+            bt,
+            BT_METADATA_FIELD_TITLE,
+            BC127MessageGetRemainder(message, 3)
+        );
     } else if (strcmp(msgBuf[2], "ARTIST:") == 0) {
-        char artist[BT_METADATA_MAX_SIZE] = {0};
-        UtilsNormalizeText(artist, &msg[BC127_METADATA_ARTIST_OFFSET], BT_METADATA_MAX_SIZE);
-        if(strncmp(bt->artist, artist, BT_METADATA_FIELD_SIZE - 1) != 0) {
-            bt->metadataStatus = BT_METADATA_STATUS_UPD;
-            memset(bt->artist, 0, BT_METADATA_FIELD_SIZE);
-            UtilsStrncpy(bt->artist, artist, BT_METADATA_FIELD_SIZE);
-        }
-    } else {
-        if (strcmp(msgBuf[2], "ALBUM:") == 0) {
-            char album[BT_METADATA_MAX_SIZE] = {0};
-            UtilsNormalizeText(album, &msg[BC127_METADATA_ALBUM_OFFSET], BT_METADATA_MAX_SIZE);
-            if(strncmp(bt->album, album, BT_METADATA_FIELD_SIZE - 1) != 0) {
-                bt->metadataStatus = BT_METADATA_STATUS_UPD;
-                memset(bt->album, 0, BT_METADATA_FIELD_SIZE);
-                UtilsStrncpy(bt->album, album, BT_METADATA_FIELD_SIZE);
-            }
-        }
-        if (bt->metadataStatus == BT_METADATA_STATUS_UPD) {
-            LogDebug(
-                LOG_SOURCE_BT,
-                "BT: title=%s,artist=%s,album=%s",
-                bt->title,
-                bt->artist,
-                bt->album
-            );
-            EventTriggerCallback(BT_EVENT_METADATA_UPDATE, 0);
-        }
-        bt->metadataStatus = BT_METADATA_STATUS_CUR;
+        BTMetadataSetField(
+            bt,
+            BT_METADATA_FIELD_ARTIST,
+            BC127MessageGetRemainder(message, 3)
+        );
+    } else if (strcmp(msgBuf[2], "ALBUM:") == 0) {
+        BTMetadataSetField(
+            bt,
+            BT_METADATA_FIELD_ALBUM,
+            BC127MessageGetRemainder(message, 3)
+        );
     }
     bt->metadataTimestamp = TimerGetMillis();
 }
@@ -1408,7 +1897,6 @@ void BC127ProcessEventBuild(BT_t *bt, char **msgBuf)
     memset(&bt->activeDevice, 0, sizeof(BTConnection_t));
     bt->activeDevice = BTConnectionInit();
     bt->callStatus = BT_CALL_INACTIVE;
-    bt->metadataStatus = BT_METADATA_STATUS_CUR;
     LogDebug(LOG_SOURCE_BT, "BT: Boot Complete");
     EventTriggerCallback(BT_EVENT_BOOT, 0);
     EventTriggerCallback(BT_EVENT_PLAYBACK_STATUS_CHANGE, 0);
@@ -1546,19 +2034,21 @@ void BC127ProcessEventList(BT_t *bt, char **msgBuf)
  *         Process the NAME event
  *     Params:
  *         BT_t *bt - A pointer to the module object
- *         char **msgBuf - The message buffer split into an array using spaces as the delimiter
+ *         BC127Message_t *message - The tokenized message
  *     Returns:
  *         void
  */
-void BC127ProcessEventName(BT_t *bt, char **msgBuf, char *msg)
+void BC127ProcessEventName(BT_t *bt, BC127Message_t *message)
 {
+    char **msgBuf = message->tokens;
     char deviceName[BT_DEVICE_NAME_LEN] = {0};
-    uint8_t idx;
+    uint16_t idx;
     uint8_t strIdx = 0;
-    uint8_t nameLen = strlen(msg);
-    if (nameLen > BC127_DEVICE_NAME_OFFSET) {
-        for (idx = 0; idx < nameLen - BC127_DEVICE_NAME_OFFSET; idx++) {
-            char c = msg[idx + BC127_DEVICE_NAME_OFFSET];
+    if (message->count > 2) {
+        char *rawName = BC127MessageGetRemainder(message, 2);
+        uint16_t nameLen = strlen(rawName);
+        for (idx = 0; idx < nameLen && strIdx < BT_DEVICE_NAME_LEN - 1; idx++) {
+            char c = rawName[idx];
             // 0x22 (") is the character that wraps the device name
             if (c != 0x22) {
                 deviceName[strIdx] = c;
@@ -1741,77 +2231,113 @@ void BC127Process(BT_t *bt)
         // We received a valid message, so set the power & state to on
         bt->powerState = BT_STATE_ON;
         char msg[messageLength];
+        BC127Message_t message;
         uint16_t i;
-        uint16_t delimCount = 1;
+        uint8_t inToken = 0;
+        message.text = msg;
+        message.count = 0;
+        // Record the tokens while the message is read out of the queue
         for (i = 0; i < messageLength; i++) {
             char c = CharQueueNext(&bt->uart.rxQueue);
-            if (c == BC127_MSG_DELIMETER) {
-                delimCount++;
-            }
-            if (c != BC127_MSG_END_CHAR) {
-                msg[i] = c;
-            } else {
+            if (c == BC127_MSG_END_CHAR) {
                 // The protocol states that 0x0D delimits messages,
                 // so we change it to a null terminator instead
                 msg[i] = '\0';
+                continue;
+            }
+            msg[i] = c;
+            if (c == BC127_MSG_DELIMETER &&
+                message.count < BC127_MSG_MAX_TOKENS
+            ) {
+                inToken = 0;
+            } else if (inToken == 1) {
+                message.lengths[message.count - 1]++;
+            } else if (c != BC127_MSG_DELIMETER) {
+                message.tokens[message.count] = &msg[i];
+                message.lengths[message.count] = 1;
+                message.count++;
+                inToken = 1;
             }
-        }
-        // Copy the message, since strtok adds a null terminator after the first
-        // occurence of the delimiter, causes issues with any functions used going forward
-        char tmpMsg[messageLength];
-        strcpy(tmpMsg, msg);
-        char *msgBuf[delimCount];
-        char delimeter[] = " ";
-        char *p = strtok(tmpMsg, delimeter);
-        i = 0;
-        while (p != 0x00) {
-            msgBuf[i++] = p;
-            p = strtok(0x00, delimeter);
         }
         LogDebug(LOG_SOURCE_BT, "BT: R: '%s'", msg);
-        if (strcmp(msgBuf[0], "A2DP_STREAM_SUSPEND") == 0) {
-            BC127ProcessEventA2DPStreamSuspend(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "ABS_VOL") == 0) {
-            BC127ProcessEventAbsVol(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "AT") == 0) {
-            BC127ProcessEventAT(bt, msgBuf, delimCount);
-        } else if (strcmp(msgBuf[0], "AVRCP_MEDIA") == 0) {
-            BC127ProcessEventAVRCPMedia(bt, msgBuf, msg);
-        } else if (strcmp(msgBuf[0], "AVRCP_PLAY") == 0) {
-            BC127ProcessEventAVRCPPlay(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "AVRCP_PAUSE") == 0) {
-            BC127ProcessEventAVRCPPause(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "AVRCP_STOP") == 0) {
-            BC127ProcessEventAVRCPPause(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "Build:") == 0) {
-            BC127ProcessEventBuild(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "CALL_ACTIVE") == 0) {
-            BC127ProcessEventCall(bt, (uint8_t)BT_CALL_ACTIVE);
-        } else if (strcmp(msgBuf[0], "CALL_END") == 0) {
-            BC127ProcessEventCall(bt, (uint8_t)BT_CALL_INACTIVE);
-        } else if (strcmp(msgBuf[0], "CALL_INCOMING") == 0) {
-            BC127ProcessEventCall(bt, (uint8_t)BT_CALL_INCOMING);
-        } else if (strcmp(msgBuf[0], "CALL_OUTGOING") == 0) {
-            BC127ProcessEventCall(bt, (uint8_t)BT_CALL_OUTGOING);
-        } else if (strcmp(msgBuf[0], "CLOSE_OK") == 0) {
-            BC127ProcessEventCloseOk(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "LINK") == 0) {
-            BC127ProcessEventLink(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "LIST") == 0) {
-            BC127ProcessEventList(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "NAME") == 0) {
-            BC127ProcessEventName(bt, msgBuf, msg);
-        } else if (strcmp(msgBuf[0], "OPEN_ERROR") == 0) {
-            BC127ProcessEventOpenError(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "OPEN_OK") == 0) {
-            BC127ProcessEventOpenOk(bt, msgBuf);
-        } else if (strcmp(msgBuf[0], "SCO_CLOSE") == 0) {
-            BC127ProcessEventSCO(bt, (uint8_t)BT_CALL_SCO_CLOSE);
-        } else if (strcmp(msgBuf[0], "SCO_OPEN") == 0) {
-            BC127ProcessEventSCO(bt, (uint8_t)BT_CALL_SCO_OPEN);
-        } else if (strcmp(msgBuf[0], "STATE") == 0) {
-            BC127ProcessEventState(bt, msgBuf);
+        TraceEvent(TRACE_EVENT_BT_RX, (uint8_t *) msg, messageLength);
+        // Terminate the tokens in place, now that the message was logged
+        for (i = 0; i < BC127_MSG_MAX_TOKENS; i++) {
+            if (i < message.count) {
+                message.tokens[i][message.lengths[i]] = '\0';
+            } else {
+                message.tokens[i] = &msg[messageLength - 1];
+                message.lengths[i] = 0;
+            }
         }
+        char **msgBuf = message.tokens;
+        uint8_t event = BC127GetEvent(msgBuf[0]);
+        switch (event) {
+            case BC127_EVENT_A2DP_STREAM_SUSPEND:
+                BC127ProcessEventA2DPStreamSuspend(bt, msgBuf);
+                break;
+            case BC127_EVENT_ABS_VOL:
+                BC127ProcessEventAbsVol(bt, msgBuf);
+                break;
+            case BC127_EVENT_AT:
+                BC127ProcessEventAT(bt, &message);
+                break;
+            case BC127_EVENT_AVRCP_MEDIA:
+                BC127ProcessEventAVRCPMedia(bt, &message);
+                break;
+            case BC127_EVENT_AVRCP_PLAY:
+                BC127ProcessEventAVRCPPlay(bt, msgBuf);
+                break;
+            case BC127_EVENT_AVRCP_PAUSE:
+            case BC127_EVENT_AVRCP_STOP:
+                BC127ProcessEventAVRCPPause(bt, msgBuf);
+                break;
+            case BC127_EVENT_BUILD:
+                BC127ProcessEventBuild(bt, msgBuf);
+                break;
+            case BC127_EVENT_CALL_ACTIVE:
+                BC127ProcessEventCall(bt, (uint8_t)BT_CALL_ACTIVE);
+                break;
+            case BC127_EVENT_CALL_END:
+                BC127ProcessEventCall(bt, (uint8_t)BT_CALL_INACTIVE);
+                break;
+            case BC127_EVENT_CALL_INCOMING:
+                BC127ProcessEventCall(bt, (uint8_t)BT_CALL_INCOMING);
+                break;
+            case BC127_EVENT_CALL_OUTGOING:
+                BC127ProcessEventCall(bt, (uint8_t)BT_CALL_OUTGOING);
+                break;
+            case BC127_EVENT_CLOSE_OK:
+                BC127ProcessEventCloseOk(bt, msgBuf);
+                break;
+            case BC127_EVENT_LINK:
+                BC127ProcessEventLink(bt, msgBuf);
+                break;
+            case BC127_EVENT_LIST:
+                BC127ProcessEventList(bt, msgBuf);
+                break;
+            case BC127_EVENT_NAME:
+                BC127ProcessEventName(bt, &message);
+                break;
+            case BC127_EVENT_OPEN_ERROR:
+                BC127ProcessEventOpenError(bt, msgBuf);
+                break;
+            case BC127_EVENT_OPEN_OK:
+                BC127ProcessEventOpenOk(bt, msgBuf);
+                break;
+            case BC127_EVENT_SCO_CLOSE:
+                BC127ProcessEventSCO(bt, (uint8_t)BT_CALL_SCO_CLOSE);
+                break;
+            case BC127_EVENT_SCO_OPEN:
+                BC127ProcessEventSCO(bt, (uint8_t)BT_CALL_SCO_OPEN);
+                break;
+            case BC127_EVENT_STATE:
+                BC127ProcessEventState(bt, msgBuf);
+                break;
+        }
+        // Complete commands once the event has been handled, so that their
+        // callbacks see the updated state
+        BC127CommandQueueResponse(event, msgBuf);
         // Reset the age of the Rx queue
         bt->rxQueueAge = 0;
     } else if (CharQueueGetSize(&bt->uart.rxQueue) > 0) {
@@ -1825,13 +2351,14 @@ void BC127Process(BT_t *bt)
             }
         }
     }
+    BC127CommandQueueProcess(bt);
     UARTReportErrors(&bt->uart);
 }
 
 /**
  * BC127SendCommand()
  *     Description:
- *         Send data over UART
+ *         Queue a command that is answered with OK or ERROR
  *     Params:
  *         BT_t *bt - A pointer to the module object
  *         char *command - A command to send, with null termination included
@@ -1840,16 +2367,49 @@ void BC127Process(BT_t *bt)
  */
 void BC127SendCommand(BT_t *bt, char *command)
 {
-    LogDebug(LOG_SOURCE_BT, "BT: W: '%s'", command);
-    uint8_t idx = 0;
-    uint16_t cmdLength = strlen(command) + 1;
-    uint8_t data[cmdLength];
-    memset(data, 0, cmdLength);
-    for (idx = 0; idx < strlen(command); idx++) {
-        data[idx] = command[idx];
-    }
-    data[idx++] = BC127_MSG_END_CHAR;
-    UARTSendData(&bt->uart, data, cmdLength);
+    BC127SendCommandCallback(
+        bt,
+        command,
+        BC127_EVENT_OK,
+        BC127_CMD_TAG_NONE,
+        0,
+        0
+    );
+}
+
+/**
+ * BC127SendCommandCallback()
+ *     Description:
+ *         Queue a command that completes once the given event, an error or
+ *         the timeout occurs
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         char *command - A command to send, with null termination included
+ *         uint8_t response - The event that answers the command
+ *         uint8_t tag - Identifies the request in the callback
+ *         BC127CommandCallback_t callback - Called once the command
+ *             completes, may be 0
+ *         void *context - The context to give to the callback
+ *     Returns:
+ *         uint8_t - 1 if the command was queued, 0 if the queue is full
+ */
+uint8_t BC127SendCommandCallback(
+    BT_t *bt,
+    char *command,
+    uint8_t response,
+    uint8_t tag,
+    BC127CommandCallback_t callback,
+    void *context
+) {
+    return BC127CommandQueueAdd(
+        bt,
+        command,
+        response,
+        0,
+        tag,
+        callback,
+        context
+    );
 }
 
 /**
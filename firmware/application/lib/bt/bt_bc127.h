@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "../../mappings.h"
+#include "../char_queue.h"
 #include "../log.h"
 #include "../event.h"
 #include "../timer.h"
@@ -21,15 +22,13 @@
 #define BC127_AUDIO_SPDIF "2"
 #define BC127_CLOSE_ALL 255
 #define BC127_DEVICE_NAME_LEN 64
-#define BC127_DEVICE_NAME_OFFSET 19
 #define BC127_MAX_DEVICE_PAIRED 8
 #define BC127_MAX_DEVICE_PROFILES 5
-#define BC127_METADATA_TITLE_OFFSET 22
-#define BC127_METADATA_ARTIST_OFFSET 23
-#define BC127_METADATA_ALBUM_OFFSET 22
 #define BC127_MSG_END_CHAR 0x0D
 #define BC127_MSG_LF_CHAR 0x0A
 #define BC127_MSG_DELIMETER 0x20
+// Further delimiters are kept within the last token
+#define BC127_MSG_MAX_TOKENS 16
 #define BC127_SHORT_NAME_MAX_LEN 8
 #define BC127_PROFILE_COUNT 9
 #define BC127_RX_QUEUE_TIMEOUT 750
@@ -44,6 +43,153 @@
 #define BC127_AT_DATE_HOUR 3
 #define BC127_AT_DATE_MIN 4
 #define BC127_AT_DATE_SEC 5
+/* Messages that the BC127 sends, identified by their first token */
+#define BC127_EVENT_UNKNOWN 0
+#define BC127_EVENT_A2DP_STREAM_SUSPEND 1
+#define BC127_EVENT_ABS_VOL 2
+#define BC127_EVENT_AT 3
+#define BC127_EVENT_AVRCP_MEDIA 4
+#define BC127_EVENT_AVRCP_PLAY 5
+#define BC127_EVENT_AVRCP_PAUSE 6
+#define BC127_EVENT_AVRCP_STOP 7
+#define BC127_EVENT_BUILD 8
+#define BC127_EVENT_CALL_ACTIVE 9
+#define BC127_EVENT_CALL_END 10
+#define BC127_EVENT_CALL_INCOMING 11
+#define BC127_EVENT_CALL_OUTGOING 12
+#define BC127_EVENT_CLOSE_OK 13
+#define BC127_EVENT_LINK 14
+#define BC127_EVENT_LIST 15
+#define BC127_EVENT_NAME 16
+#define BC127_EVENT_OPEN_ERROR 17
+#define BC127_EVENT_OPEN_OK 18
+#define BC127_EVENT_SCO_CLOSE 19
+#define BC127_EVENT_SCO_OPEN 20
+#define BC127_EVENT_STATE 21
+#define BC127_EVENT_ERROR 22
+#define BC127_EVENT_OK 23
+#define BC127_EVENT_COUNT 23
+#define BC127_EVENT(name, event) {sizeof(name) - 1, name, event}
+/* Command Queue */
+// CLI RESTORE queues 17 commands in a row, leave room for a few more in flight
+#define BC127_CMD_QUEUE_SIZE 20
+// The BC127 answers OK and ERROR in order, so they are matched to the oldest
+// command in flight that awaits them. Commands answered by an event, such as
+// OPEN, do not count against the limit.
+#define BC127_CMD_MAX_IN_FLIGHT 1
+#define BC127_CMD_PROFILE_LEN 6
+#define BC127_CMD_TIMEOUT 1000
+#define BC127_CMD_TIMEOUT_EVENT 5000
+#define BC127_CMD_RESULT_OK 0
+#define BC127_CMD_RESULT_ERROR 1
+#define BC127_CMD_RESULT_TIMEOUT 2
+#define BC127_CMD_TAG_NONE 0
+#define BC127_CMD_TAG_METADATA 1
+// Offset by the profile link ID
+#define BC127_CMD_TAG_PROFILE_OPEN 0x10
+
+/**
+ * BC127Message_t
+ *     Description:
+ *         A message from the BC127, split into tokens in place
+ *     Fields:
+ *         text - The message. Tokens are null terminated once the message
+ *             has been read completely.
+ *         count - The number of tokens
+ *         tokens - The start of each token. Missing tokens point to an empty
+ *             string, so handlers may index beyond count.
+ *         lengths - The length of each token
+ */
+typedef struct BC127Message_t {
+    char *text;
+    uint8_t count;
+    char *tokens[BC127_MSG_MAX_TOKENS];
+    uint16_t lengths[BC127_MSG_MAX_TOKENS];
+} BC127Message_t;
+
+/**
+ * BC127Event_t
+ *     Description:
+ *         Maps the first token of a BC127 message to its event
+ *     Fields:
+ *         length - The length of the token, which is compared first
+ *         name - The token
+ *         event - The event, see BC127_EVENT_*
+ */
+typedef struct BC127Event_t {
+    uint8_t length;
+    const char *name;
+    uint8_t event;
+} BC127Event_t;
+
+/**
+ * BC127CommandResult_t
+ *     Description:
+ *         The outcome of a command, as given to its completion callback
+ *     Fields:
+ *         result - BC127_CMD_RESULT_OK, _ERROR or _TIMEOUT
+ *         tag - The tag given when the command was queued
+ *         latency - Milliseconds from sending the command to its response
+ */
+typedef struct BC127CommandResult_t {
+    uint8_t result;
+    uint8_t tag;
+    uint16_t latency;
+} BC127CommandResult_t;
+
+typedef void (*BC127CommandCallback_t)(void *, BC127CommandResult_t *);
+
+/**
+ * BC127Command_t
+ *     Description:
+ *         A queued command. The command text is kept in a separate character
+ *         queue, in the same order as the commands. Commands that were sent
+ *         are at the front of the queue.
+ *     Fields:
+ *         length - The length of the command text
+ *         response - The event that completes the command successfully.
+ *             ERROR always completes it with an error.
+ *         profile - The profile that an OPEN_OK or OPEN_ERROR must name to
+ *             answer the command, empty to accept any
+ *         tag - Identifies the request to the caller
+ *         timestamp - The time the command was sent at, 0 until then
+ *         callback - Called once the command completes, may be 0
+ *         context - The context given to the callback
+ */
+typedef struct BC127Command_t {
+    uint16_t length;
+    uint8_t response;
+    char profile[BC127_CMD_PROFILE_LEN];
+    uint8_t tag;
+    uint32_t timestamp;
+    BC127CommandCallback_t callback;
+    void *context;
+} BC127Command_t;
+
+/**
+ * BC127CommandStats_t
+ *     Description:
+ *         Counters for the command queue
+ *     Fields:
+ *         completed - Commands that received their response
+ *         errors - Commands that were answered with an error
+ *         timeouts - Commands that were never answered
+ *         dropped - Commands that did not fit in the queue
+ *         latencyLast - The round trip time of the last command in ms
+ *         latencyMax - The longest round trip time in ms
+ *         latencyTotal - The sum of all round trip times, for the average
+ *         peak - The most commands queued at once
+ */
+typedef struct BC127CommandStats_t {
+    uint32_t completed;
+    uint32_t errors;
+    uint32_t timeouts;
+    uint32_t dropped;
+    uint16_t latencyLast;
+    uint16_t latencyMax;
+    uint32_t latencyTotal;
+    uint8_t peak;
+} BC127CommandStats_t;
 
 extern int8_t BTBC127MicGainTable[];
 
@@ -76,6 +222,16 @@ void BC127CommandPause(BT_t *);
 void BC127CommandPlay(BT_t *);
 void BC127CommandProfileClose(BT_t *, uint8_t);
 void BC127CommandProfileOpen(BT_t *, char *);
+void BC127CommandProfileOpenCallback(
+    BT_t *,
+    char *,
+    uint8_t,
+    BC127CommandCallback_t,
+    void *
+);
+uint8_t BC127CommandQueueGetDepth();
+BC127CommandStats_t *BC127CommandQueueGetStats();
+uint8_t BC127CommandQueueHasTag(uint8_t);
 void BC127CommandReset(BT_t *);
 void BC127CommandSetAudio(BT_t *, uint8_t, uint8_t);
 void BC127CommandSetAudioAnalog(BT_t *, uint8_t, uint8_t, uint8_t, char *);
@@ -101,10 +257,12 @@ void BC127CommandVolume(BT_t *, uint8_t, char *);
 void BC127CommandWrite(BT_t *);
 uint8_t BC127GetConnectedDeviceCount(BT_t *);
 uint8_t BC127GetDeviceId(char *);
+uint8_t BC127GetEvent(const char *);
+char *BC127MessageGetRemainder(BC127Message_t *, uint8_t);
 void BC127ProcessEventA2DPStreamSuspend(BT_t *, char **);
 void BC127ProcessEventAbsVol(BT_t *, char **);
-void BC127ProcessEventAT(BT_t *, char **, uint8_t);
-void BC127ProcessEventAVRCPMedia(BT_t *, char **, char *);
+void BC127ProcessEventAT(BT_t *, BC127Message_t *);
+void BC127ProcessEventAVRCPMedia(BT_t *, BC127Message_t *);
 void BC127ProcessEventAVRCPPlay(BT_t *, char **);
 void BC127ProcessEventAVRCPPause(BT_t *, char **);
 void BC127ProcessEventAVRCPPause(BT_t *, char **);
@@ -113,13 +271,21 @@ void BC127ProcessEventCall(BT_t *, uint8_t);
 void BC127ProcessEventCloseOk(BT_t *, char **);
 void BC127ProcessEventLink(BT_t *, char **);
 void BC127ProcessEventList(BT_t *, char **);
-void BC127ProcessEventName(BT_t *, char **, char *);
+void BC127ProcessEventName(BT_t *, BC127Message_t *);
 void BC127ProcessEventOpenError(BT_t *, char **);
 void BC127ProcessEventOpenOk(BT_t *, char **);
 void BC127ProcessEventSCO(BT_t *, uint8_t);
 void BC127ProcessEventState(BT_t *, char **);
 void BC127Process(BT_t *);
 void BC127SendCommand(BT_t *, char *);
+uint8_t BC127SendCommandCallback(
+    BT_t *,
+    char *,
+    uint8_t,
+    uint8_t,
+    BC127CommandCallback_t,
+    void *
+);
 void BC127SendCommandEmpty(BT_t *);
 
 void BC127ConvertMACIDToHex(char *, unsigned char *);
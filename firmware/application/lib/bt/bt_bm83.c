@@ -26,10 +26,251 @@ int8_t BTBM83MicGainTable[] = {
     46
 };
 
+static BM83FrameParser_t BM83RXFrame;
+static BM83Command_t BM83CommandQueue[BM83_CMD_QUEUE_SIZE];
+static uint8_t BM83CommandQueueDepth = 0;
+static BM83CommandStats_t BM83CommandQueueStats[BM83_CMD_STATS_SIZE];
+static uint8_t BM83CommandQueueStatsCount = 0;
+static BM83MetadataCacheEntry_t BM83MetadataCache[BM83_METADATA_CACHE_SIZE];
+static BM83MetadataCacheStats_t BM83MetadataCacheStats;
+static uint32_t BM83MetadataCacheClock = 0;
+static uint8_t BM83MetadataTrackUID[BM83_AVRCP_TRACK_UID_SIZE];
+// The track UID at the time of the last request, which its response is for
+static uint8_t BM83MetadataRequestUID[BM83_AVRCP_TRACK_UID_SIZE];
+static uint32_t BM83MetadataRequestTimestamp = 0;
+// The text is normalized for the language and UI mode
+static uint8_t BM83MetadataCacheLanguage = 0;
+static uint8_t BM83MetadataCacheUIMode = 0;
+
+/**
+ * BM83MetadataCacheHasTrackUID()
+ *     Description:
+ *         Check if the current track UID identifies a track. Players that do
+ *         not support browsing report all zeros, and all ones when nothing
+ *         is selected.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if the track UID can be used as a cache key
+ */
+static uint8_t BM83MetadataCacheHasTrackUID()
+{
+    uint8_t zeros = 0;
+    uint8_t ones = 0;
+    uint8_t idx = 0;
+    for (idx = 0; idx < BM83_AVRCP_TRACK_UID_SIZE; idx++) {
+        if (BM83MetadataTrackUID[idx] == 0x00) {
+            zeros++;
+        } else if (BM83MetadataTrackUID[idx] == 0xFF) {
+            ones++;
+        }
+    }
+    if (zeros == BM83_AVRCP_TRACK_UID_SIZE || ones == BM83_AVRCP_TRACK_UID_SIZE) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * BM83MetadataCacheClearTrackUIDs()
+ *     Description:
+ *         Forget the current track UID and untie every cache entry from its
+ *         track UID. Track UIDs are only valid for the player and UID counter
+ *         that sent them, so this is needed whenever either changes. The
+ *         cached text is kept, since it can still be found by its hash.
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+static void BM83MetadataCacheClearTrackUIDs()
+{
+    uint8_t idx = 0;
+    memset(BM83MetadataTrackUID, 0, BM83_AVRCP_TRACK_UID_SIZE);
+    for (idx = 0; idx < BM83_METADATA_CACHE_SIZE; idx++) {
+        memset(BM83MetadataCache[idx].uid, 0, BM83_AVRCP_TRACK_UID_SIZE);
+    }
+    // Any pending request was for the previous player or list
+    BM83MetadataRequestTimestamp = 0;
+}
+
+/**
+ * BM83MetadataCacheSetTrackUID()
+ *     Description:
+ *         Tie the current track UID to a cache entry, and untie it from the
+ *         entry that held it before. Nothing is tied if the track changed
+ *         after the request that the entry answers was sent.
+ *     Params:
+ *         BM83MetadataCacheEntry_t *entry - The entry for the current track
+ *     Returns:
+ *         void
+ */
+static void BM83MetadataCacheSetTrackUID(BM83MetadataCacheEntry_t *entry)
+{
+    if (BM83MetadataCacheHasTrackUID() == 0 ||
+        memcmp(
+            BM83MetadataRequestUID,
+            BM83MetadataTrackUID,
+            BM83_AVRCP_TRACK_UID_SIZE
+        ) != 0
+    ) {
+        return;
+    }
+    uint8_t idx = 0;
+    for (idx = 0; idx < BM83_METADATA_CACHE_SIZE; idx++) {
+        if (memcmp(
+            BM83MetadataCache[idx].uid,
+            BM83MetadataTrackUID,
+            BM83_AVRCP_TRACK_UID_SIZE
+        ) == 0) {
+            memset(BM83MetadataCache[idx].uid, 0, BM83_AVRCP_TRACK_UID_SIZE);
+        }
+    }
+    memcpy(entry->uid, BM83MetadataTrackUID, BM83_AVRCP_TRACK_UID_SIZE);
+}
+
+/**
+ * BM83MetadataCacheApply()
+ *     Description:
+ *         Store the fields of a cache entry as the current metadata, without
+ *         normalizing them again
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         BM83MetadataCacheEntry_t *entry - The cache entry
+ *     Returns:
+ *         void
+ */
+static void BM83MetadataCacheApply(BT_t *bt, BM83MetadataCacheEntry_t *entry)
+{
+    entry->lastUsed = ++BM83MetadataCacheClock;
+    if ((entry->fields & BT_METADATA_FIELD_TITLE) != 0) {
+        BTMetadataSetNormalizedField(bt, BT_METADATA_FIELD_TITLE, entry->title);
+    }
+    if ((entry->fields & BT_METADATA_FIELD_ARTIST) != 0) {
+        BTMetadataSetNormalizedField(bt, BT_METADATA_FIELD_ARTIST, entry->artist);
+    }
+    if ((entry->fields & BT_METADATA_FIELD_ALBUM) != 0) {
+        BTMetadataSetNormalizedField(bt, BT_METADATA_FIELD_ALBUM, entry->album);
+    }
+}
+
+/**
+ * BM83MetadataCacheCheckLocale()
+ *     Description:
+ *         Empty the cache if the language or UI mode changed since its
+ *         entries were normalized
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+static void BM83MetadataCacheCheckLocale()
+{
+    uint8_t language = ConfigGetSetting(CONFIG_SETTING_LANGUAGE);
+    uint8_t uiMode = ConfigGetUIMode();
+    if (language != BM83MetadataCacheLanguage ||
+        uiMode != BM83MetadataCacheUIMode
+    ) {
+        memset(BM83MetadataCache, 0, sizeof(BM83MetadataCache));
+        BM83MetadataCacheLanguage = language;
+        BM83MetadataCacheUIMode = uiMode;
+    }
+}
+
+/**
+ * BM83MetadataCacheFind()
+ *     Description:
+ *         Find the cache entry holding the attributes with the given hash.
+ *         Entries normalized for another language or UI mode are dropped.
+ *     Params:
+ *         uint32_t hash - The hash of the raw attributes
+ *     Returns:
+ *         BM83MetadataCacheEntry_t * - The entry, or 0 if there is none
+ */
+static BM83MetadataCacheEntry_t *BM83MetadataCacheFind(uint32_t hash)
+{
+    BM83MetadataCacheCheckLocale();
+    uint8_t idx = 0;
+    for (idx = 0; idx < BM83_METADATA_CACHE_SIZE; idx++) {
+        if (BM83MetadataCache[idx].fields != 0 &&
+            BM83MetadataCache[idx].hash == hash
+        ) {
+            return &BM83MetadataCache[idx];
+        }
+    }
+    return 0;
+}
+
+/**
+ * BM83MetadataCacheFindTrack()
+ *     Description:
+ *         Find the cache entry tied to the current track UID
+ *     Params:
+ *         None
+ *     Returns:
+ *         BM83MetadataCacheEntry_t * - The entry, or 0 if there is none
+ */
+static BM83MetadataCacheEntry_t *BM83MetadataCacheFindTrack()
+{
+    BM83MetadataCacheCheckLocale();
+    if (BM83MetadataCacheHasTrackUID() == 0) {
+        return 0;
+    }
+    uint8_t idx = 0;
+    for (idx = 0; idx < BM83_METADATA_CACHE_SIZE; idx++) {
+        if (BM83MetadataCache[idx].fields != 0 &&
+            memcmp(
+                BM83MetadataCache[idx].uid,
+                BM83MetadataTrackUID,
+                BM83_AVRCP_TRACK_UID_SIZE
+            ) == 0
+        ) {
+            return &BM83MetadataCache[idx];
+        }
+    }
+    return 0;
+}
+
+/**
+ * BM83MetadataCacheStore()
+ *     Description:
+ *         Copy the current metadata into the least recently used entry
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint32_t hash - The hash of the raw attributes
+ *         uint8_t fields - The fields that the attributes held
+ *     Returns:
+ *         void
+ */
+static void BM83MetadataCacheStore(BT_t *bt, uint32_t hash, uint8_t fields)
+{
+    BM83MetadataCacheEntry_t *entry = &BM83MetadataCache[0];
+    uint8_t idx = 0;
+    for (idx = 1; idx < BM83_METADATA_CACHE_SIZE; idx++) {
+        if (BM83MetadataCache[idx].lastUsed < entry->lastUsed) {
+            entry = &BM83MetadataCache[idx];
+        }
+    }
+    memset(entry, 0, sizeof(BM83MetadataCacheEntry_t));
+    entry->hash = hash;
+    entry->fields = fields;
+    entry->lastUsed = ++BM83MetadataCacheClock;
+    if ((fields & BT_METADATA_FIELD_TITLE) != 0) {
+        UtilsStrncpy(entry->title, bt->title, BT_METADATA_FIELD_SIZE);
+    }
+    if ((fields & BT_METADATA_FIELD_ARTIST) != 0) {
+        UtilsStrncpy(entry->artist, bt->artist, BT_METADATA_FIELD_SIZE);
+    }
+    if ((fields & BT_METADATA_FIELD_ALBUM) != 0) {
+        UtilsStrncpy(entry->album, bt->album, BT_METADATA_FIELD_SIZE);
+    }
+    BM83MetadataCacheSetTrackUID(entry);
+}
+
 /**
  * BM83CommandAVRCPGetCapabilities()
  *     Description:
- *         TODO
+ *         Request the AVRCP events that the device supports
  *     Params:
  *         BT_t *bt - A pointer to the module object
  *     Returns:
@@ -52,7 +293,9 @@ void BM83CommandAVRCPGetCapabilities(BT_t *bt)
 /**
  * BM83CommandAVRCPGetElementAttributesAll()
  *     Description:
- *         TODO
+ *         Request the title, artist and album of the current track. The
+ *         request is skipped if the cache already holds the track, or if
+ *         the previous request is still unanswered.
  *     Params:
  *         BT_t *bt - A pointer to the module object
  *     Returns:
@@ -60,6 +303,21 @@ void BM83CommandAVRCPGetCapabilities(BT_t *bt)
  */
 void BM83CommandAVRCPGetElementAttributesAll(BT_t *bt)
 {
+    BM83MetadataCacheEntry_t *entry = BM83MetadataCacheFindTrack();
+    if (entry != 0) {
+        BM83MetadataCacheStats.trackHits++;
+        BM83MetadataCacheApply(bt, entry);
+        return;
+    }
+    uint32_t now = TimerGetMillis();
+    if (BM83MetadataRequestTimestamp != 0 &&
+        now - BM83MetadataRequestTimestamp < BM83_METADATA_REQUEST_TIMEOUT
+    ) {
+        BM83MetadataCacheStats.suppressed++;
+        return;
+    }
+    BM83MetadataRequestTimestamp = now;
+    memcpy(BM83MetadataRequestUID, BM83MetadataTrackUID, BM83_AVRCP_TRACK_UID_SIZE);
     uint8_t command[] = {
         BM83_CMD_AVC_VENDOR_DEPENDENT_CMD,
         bt->activeDevice.deviceId & 0xF, // Linked Database, the lower nibble
@@ -83,9 +341,11 @@ void BM83CommandAVRCPGetElementAttributesAll(BT_t *bt)
 /**
  * BM83CommandAVRCPRegisterNotification()
  *     Description:
- *         TODO
+ *         Ask the device to notify us once of a change to the given event.
+ *         The registration has to be repeated after every notification.
  *     Params:
  *         BT_t *bt - A pointer to the module object
+ *         uint8_t event - See BM83_AVRCP_EVT_*
  *     Returns:
  *         void
  */
@@ -538,6 +798,33 @@ void BM83CommandVoiceRecognitionOpen(BT_t *bt)
     BM83SendCommand(bt, command, sizeof(command));
 }
 
+/**
+ * BM83ProcessAVRCPPlaybackStatus()
+ *     Description:
+ *         Store the playback status reported by an AVRCP notification
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint8_t status - See BM83_AVRCP_DATA_PLAYBACK_STATUS_*
+ *     Returns:
+ *         void
+ */
+static void BM83ProcessAVRCPPlaybackStatus(BT_t *bt, uint8_t status)
+{
+    if (status == BM83_AVRCP_DATA_PLAYBACK_STATUS_PAUSED &&
+        bt->playbackStatus != BT_AVRCP_STATUS_PAUSED
+    ) {
+        bt->playbackStatus = BT_AVRCP_STATUS_PAUSED;
+        EventTriggerCallback(BT_EVENT_PLAYBACK_STATUS_CHANGE, 0);
+        LogDebug(LOG_SOURCE_BT, "BT: Paused");
+    } else if (status == BM83_AVRCP_DATA_PLAYBACK_STATUS_PLAYING &&
+        bt->playbackStatus != BT_AVRCP_STATUS_PLAYING
+    ) {
+        bt->playbackStatus = BT_AVRCP_STATUS_PLAYING;
+        EventTriggerCallback(BT_EVENT_PLAYBACK_STATUS_CHANGE, 0);
+        LogDebug(LOG_SOURCE_BT, "BT: Playing");
+    }
+}
+
 /**
  * BM83ProcessEventAVCSpecificRsp()
  *     Description:
@@ -600,9 +887,16 @@ void BM83ProcessEventAVCSpecificRsp(BT_t *bt, uint8_t *data, uint16_t length)
                         case BM83_AVRCP_EVT_VOLUME_CHANGED:
                             bt->activeDevice.avrcpCaps.volumeChanged = 1;
                             break;
+                        case BM83_AVRCP_EVT_ADDRESSED_PLAYER_CHANGED:
+                            bt->activeDevice.avrcpCaps.addressedPlayerChanged = 1;
+                            break;
                     }
                 }
-                uint8_t updateData[2] = {BM83_AVRCP_PDU_GET_CAPABILITIES, 0x00};
+                uint8_t updateData[3] = {
+                    BM83_AVRCP_PDU_GET_CAPABILITIES,
+                    BM83_DATA_AVC_RSP_STABLE,
+                    0x00
+                };
                 EventTriggerCallback(BT_EVENT_AVRCP_PDU_CHANGE, updateData);
             } else if (pduId == BM83_AVRCP_PDU_GET_ELEMENT_ATTRIBUTES) {
                 uint8_t attributeCount = data[BM83_FRAME_DB11];
@@ -610,7 +904,8 @@ void BM83ProcessEventAVCSpecificRsp(BT_t *bt, uint8_t *data, uint16_t length)
                     bt,
                     data,
                     attributeCount,
-                    BM83_FRAME_DB12
+                    BM83_FRAME_DB12,
+                    length
                 );
             }
             break;
@@ -618,46 +913,62 @@ void BM83ProcessEventAVCSpecificRsp(BT_t *bt, uint8_t *data, uint16_t length)
         case BM83_DATA_AVC_RSP_INTERIM: {
             uint8_t updateType = data[BM83_FRAME_DB11];
             LogDebug(LOG_SOURCE_BT, "BT: AVRCP Interim: %02X -> %02X", pduId, updateType);
-            if (updateType == BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED ||
-                updateType == BM83_AVRCP_EVT_NOW_PLAYING_CONTENT_CHANGED ||
-                updateType == BM83_AVRCP_EVT_ADDRESSED_PLAYER_CHANGED
-            ) {
-                uint8_t updateData[2] = {updateType, BM83_DATA_AVC_RSP_INTERIM};
+            if (pduId == BM83_AVRCP_PDU_NOTIFICATION) {
+                uint8_t status = 0x00;
+                if (length > BM83_FRAME_DB12) {
+                    status = data[BM83_FRAME_DB12];
+                }
+                // The interim response to a registration holds the current value
+                if (updateType == BM83_AVRCP_EVT_PLAYBACK_STATUS_CHANGED) {
+                    BM83ProcessAVRCPPlaybackStatus(bt, status);
+                }
+                uint8_t updateData[3] = {
+                    updateType,
+                    BM83_DATA_AVC_RSP_INTERIM,
+                    status
+                };
                 EventTriggerCallback(BT_EVENT_AVRCP_PDU_CHANGE, updateData);
             }
             break;
         }
         case BM83_DATA_AVC_RSP_CHANGED: {
-            uint8_t pduId = data[BM83_FRAME_DB7];
             uint8_t updateType = data[BM83_FRAME_DB11];
             LogDebug(LOG_SOURCE_BT, "BT: AVRCP Changed: %02X -> %02X", pduId, updateType);
             if (pduId == BM83_AVRCP_PDU_NOTIFICATION) {
-                uint8_t status = data[BM83_FRAME_DB12];
+                uint8_t status = 0x00;
+                if (length > BM83_FRAME_DB12) {
+                    status = data[BM83_FRAME_DB12];
+                }
                 if (updateType == BM83_AVRCP_EVT_PLAYBACK_STATUS_CHANGED) {
-                    if (status == BM83_AVRCP_DATA_PLAYBACK_STATUS_PAUSED &&
-                        bt->playbackStatus != BT_AVRCP_STATUS_PAUSED
-                    ) {
-                        bt->playbackStatus = BT_AVRCP_STATUS_PAUSED;
-                        EventTriggerCallback(BT_EVENT_PLAYBACK_STATUS_CHANGE, 0);
-                        LogDebug(LOG_SOURCE_BT, "BT: Paused");
-                    } else if (status == BM83_AVRCP_DATA_PLAYBACK_STATUS_PLAYING &&
-                        bt->playbackStatus != BT_AVRCP_STATUS_PLAYING
-                    ) {
-                        bt->playbackStatus = BT_AVRCP_STATUS_PLAYING;
-                        EventTriggerCallback(BT_EVENT_PLAYBACK_STATUS_CHANGE, 0);
-                        LogDebug(LOG_SOURCE_BT, "BT: Playing");
-                    }
-                    uint8_t updateData[2] = {updateType, status};
-                    EventTriggerCallback(BT_EVENT_AVRCP_PDU_CHANGE, updateData);
+                    BM83ProcessAVRCPPlaybackStatus(bt, status);
                 } else if (updateType == BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED) {
-                    uint8_t updateData[2] = {updateType, status};
-                    EventTriggerCallback(BT_EVENT_AVRCP_PDU_CHANGE, updateData);
+                    // The UID follows the event ID, and any pending request
+                    // was for the previous track
+                    memset(BM83MetadataTrackUID, 0, BM83_AVRCP_TRACK_UID_SIZE);
+                    if (length >= BM83_FRAME_DB12 + BM83_AVRCP_TRACK_UID_SIZE) {
+                        memcpy(
+                            BM83MetadataTrackUID,
+                            &data[BM83_FRAME_DB12],
+                            BM83_AVRCP_TRACK_UID_SIZE
+                        );
+                    }
+                    BM83MetadataRequestTimestamp = 0;
+                    bt->metadataTrackChangeTimestamp = TimerGetMillis();
                     LogDebug(LOG_SOURCE_BT, "BT: Track Changed");
+                } else if (updateType == BM83_AVRCP_EVT_NOW_PLAYING_CONTENT_CHANGED) {
+                    // Clear the UIDs before the event requests metadata
+                    BM83MetadataCacheClearTrackUIDs();
+                    LogDebug(LOG_SOURCE_BT, "BT: Now Playing Content Changed");
                 } else if (updateType == BM83_AVRCP_EVT_ADDRESSED_PLAYER_CHANGED) {
-                    uint8_t updateData[2] = {updateType, 0x00};
-                    EventTriggerCallback(BT_EVENT_AVRCP_PDU_CHANGE, updateData);
+                    BM83MetadataCacheClearTrackUIDs();
                     LogDebug(LOG_SOURCE_BT, "BT: Addressed Player Changed");
                 }
+                uint8_t updateData[3] = {
+                    updateType,
+                    BM83_DATA_AVC_RSP_CHANGED,
+                    status
+                };
+                EventTriggerCallback(BT_EVENT_AVRCP_PDU_CHANGE, updateData);
             }
             break;
         }
@@ -685,7 +996,8 @@ void BM83ProcessEventAVCVendorDependentRsp(BT_t *bt, uint8_t *data, uint16_t len
                 bt,
                 data,
                 attributeCount,
-                BM83_FRAME_DB7
+                BM83_FRAME_DB7,
+                length
             );
             break;
         }
@@ -801,6 +1113,8 @@ void BM83ProcessEventBTMStatus(BT_t *bt, uint8_t *data, uint16_t length)
             LogDebug(LOG_SOURCE_BT, "BT: ARVCP Closed");
             bt->status = BT_STATUS_DISCONNECTED;
             bt->activeDevice.avrcpId = 0;
+            // Track UIDs are only meaningful to the player that sent them
+            BM83MetadataCacheClearTrackUIDs();
             uint8_t linkType = BT_LINK_TYPE_AVRCP;
             EventTriggerCallback(BT_EVENT_DEVICE_LINK_DISCONNECTED, &linkType);
             break;
@@ -1127,219 +1441,655 @@ void BM83ProcessEventReportTypeCodec(BT_t *bt, uint8_t *data, uint16_t length)
     EventTriggerCallback(BT_EVENT_DSP_STATUS, eventData);
 }
 
+/**
+ * BM83ProcessDataGetAllAttributes()
+ *     Description:
+ *         Walk the element attributes of a GetElementAttributes response and
+ *         store the title, artist and album. The text is normalized straight
+ *         out of the frame data, and attributes that claim to extend past the
+ *         end of the frame end the walk. Attributes that were seen recently
+ *         are taken from the metadata cache instead.
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint8_t *data - The event data
+ *         uint8_t attributeCount - The number of attributes in the response
+ *         uint16_t bytePos - The offset of the first attribute
+ *         uint16_t length - The length of the event data
+ *     Returns:
+ *         void
+ */
 void BM83ProcessDataGetAllAttributes(
     BT_t *bt,
     uint8_t *data,
     uint8_t attributeCount,
-    uint16_t bytePos
+    uint16_t bytePos,
+    uint16_t length
 ) {
-    uint8_t dataDiffers = 0;
-    bt->metadataStatus = BT_METADATA_STATUS_CUR;
+    BM83MetadataRequestTimestamp = 0;
+    if (bytePos > length) {
+        return;
+    }
+    uint32_t hash = UtilsHash((char *) &data[bytePos], length - bytePos);
+    BM83MetadataCacheEntry_t *entry = BM83MetadataCacheFind(hash);
+    if (entry != 0) {
+        BM83MetadataCacheStats.hits++;
+        BM83MetadataCacheSetTrackUID(entry);
+        BM83MetadataCacheApply(bt, entry);
+        return;
+    }
+    BM83MetadataCacheStats.misses++;
+    uint8_t fields = 0;
     uint8_t i = 0;
     for (i = 0; i < attributeCount; i++) {
-        // Skip the 0 pads
-        bytePos = bytePos + 3;
-        uint8_t attributeType = data[bytePos];
-        // Skip The zero pad and the encoding type (always assume UTF-8)
-        bytePos = bytePos + 3;
-        uint16_t attributeLen = (data[bytePos + 1] & 0xFF) | (data[bytePos] << 8);
-        // Skip over the length and to the beginning of the data
-        bytePos = bytePos + 2;
-        char tempString[BT_METADATA_MAX_SIZE] = {0};
+        if (length - bytePos < BM83_AVRCP_ATTRIBUTE_HEADER_SIZE) {
+            LogWarning("BT: AVRCP attribute %d is truncated", i);
+            return;
+        }
+        // The attribute ID is 32 bits wide, but only its last byte is used
+        uint8_t attributeType = data[bytePos + BM83_AVRCP_ATTRIBUTE_OFFSET_ID];
+        // Skip the character set, the text is always assumed to be UTF-8
+        uint16_t attributeLen = (
+            data[bytePos + BM83_AVRCP_ATTRIBUTE_OFFSET_LENGTH] << 8
+        ) | data[bytePos + BM83_AVRCP_ATTRIBUTE_OFFSET_LENGTH + 1];
+        bytePos = bytePos + BM83_AVRCP_ATTRIBUTE_HEADER_SIZE;
+        if (attributeLen > length - bytePos) {
+            LogWarning(
+                "BT: AVRCP attribute %02X length %d exceeds the frame",
+                attributeType,
+                attributeLen
+            );
+            return;
+        }
+        uint8_t field = 0;
         switch (attributeType) {
-            case BM83_AVRCP_DATA_ELEMENT_TYPE_TITLE: {
-                uint16_t j = 0;
-                for (j = 0; j < attributeLen; j++) {
-                    tempString[j] = data[bytePos];
-                    bytePos++;
-                }
-                char text[BT_METADATA_MAX_SIZE] = {0};
-                UtilsNormalizeText(text, tempString, BT_METADATA_MAX_SIZE);
-                if (memcmp(text, bt->title, BT_METADATA_FIELD_SIZE) != 0) {
-                    dataDiffers = 1;
-                    memset(bt->title, 0, BT_METADATA_FIELD_SIZE);
-                    UtilsStrncpy(bt->title, text, BT_METADATA_FIELD_SIZE);
-                }
+            case BM83_AVRCP_DATA_ELEMENT_TYPE_TITLE:
+                field = BT_METADATA_FIELD_TITLE;
                 break;
-            }
-            case BM83_AVRCP_DATA_ELEMENT_TYPE_ARTIST: {
-                uint16_t j = 0;
-                for (j = 0; j < attributeLen; j++) {
-                    tempString[j] = data[bytePos];
-                    bytePos++;
-                }
-                char text[BT_METADATA_MAX_SIZE] = {0};
-                UtilsNormalizeText(text, tempString, BT_METADATA_MAX_SIZE);
-                if (memcmp(text, bt->artist, BT_METADATA_FIELD_SIZE) != 0) {
-                    dataDiffers = 1;
-                    memset(bt->artist, 0, BT_METADATA_FIELD_SIZE);
-                    UtilsStrncpy(bt->artist, text, BT_METADATA_FIELD_SIZE);
-                }
+            case BM83_AVRCP_DATA_ELEMENT_TYPE_ARTIST:
+                field = BT_METADATA_FIELD_ARTIST;
                 break;
-            }
-            case BM83_AVRCP_DATA_ELEMENT_TYPE_ALBUM: {
-                uint16_t j = 0;
-                for (j = 0; j < attributeLen; j++) {
-                    tempString[j] = data[bytePos];
-                    bytePos++;
-                }
-                char text[BT_METADATA_MAX_SIZE] = {0};
-                UtilsNormalizeText(text, tempString, BT_METADATA_MAX_SIZE);
-                if (memcmp(text, bt->album, BT_METADATA_FIELD_SIZE) != 0) {
-                    dataDiffers = 1;
-                    memset(bt->album, 0, BT_METADATA_FIELD_SIZE);
-                    UtilsStrncpy(bt->album, text, BT_METADATA_FIELD_SIZE);
-                }
-                break;
-            }
-            default:
-                bytePos = bytePos + attributeLen;
+            case BM83_AVRCP_DATA_ELEMENT_TYPE_ALBUM:
+                field = BT_METADATA_FIELD_ALBUM;
                 break;
         }
+        if (field != 0) {
+            BTMetadataSetFieldLength(
+                bt,
+                field,
+                (char *) &data[bytePos],
+                attributeLen
+            );
+            fields |= field;
+        }
+        bytePos = bytePos + attributeLen;
     }
-    if (dataDiffers == 1) {
-        LogDebug(
-            LOG_SOURCE_BT,
-            "BT: title=%s,artist=%s,album=%s",
-            bt->title,
-            bt->artist,
-            bt->album
-        );
-        EventTriggerCallback(BT_EVENT_METADATA_UPDATE, 0);
+    if (fields != 0) {
+        BM83MetadataCacheStore(bt, hash, fields);
     }
 }
 
 /**
- * BM83Process()
+ * BM83FrameResync()
  *     Description:
- *         Read the RX queue and process the messages into meaningful data
+ *         Drop the start word of the frame being parsed, so that the parser
+ *         looks for the next one
  *     Params:
- *         BT_t *bt - A pointer to the module object
+ *         BM83FrameParser_t *parser - The parser state
+ *         volatile CharQueue_t *queue - The RX queue
  *     Returns:
  *         void
  */
-void BM83Process(BT_t *bt)
+static void BM83FrameResync(BM83FrameParser_t *parser, volatile CharQueue_t *queue)
 {
-    uint16_t hasStartWord = CharQueueSeek(&bt->uart.rxQueue, BM83_UART_START_WORD);
-    uint16_t queueSize = CharQueueGetSize(&bt->uart.rxQueue);
-    if (queueSize >= BM83_FRAME_SIZE_MIN && hasStartWord != 0) {
-        if (hasStartWord != 1) {
-            LogRawDebug(LOG_SOURCE_BT, "BT: Trash Bytes: ");
-            while (hasStartWord > 1) {
-                uint8_t byte = CharQueueNext(&bt->uart.rxQueue);
-                LogRawDebug(LOG_SOURCE_BT, "%02X ", byte);
-                hasStartWord--;
-            }
-            LogRawDebug(LOG_SOURCE_BT, "\r\n");
-        }
-        uint8_t lengthHigh = CharQueueGetOffset(&bt->uart.rxQueue, 1);
-        uint8_t lengthLow = CharQueueGetOffset(&bt->uart.rxQueue, 2);
-        uint16_t frameLength = (lengthLow & 0xFF) | (lengthHigh << 8);
-        // Get the queue size again in case it has changed
-        queueSize = CharQueueGetSize(&bt->uart.rxQueue) - BM83_FRAME_CTRL_BYTE_COUNT;
-        if (queueSize >= frameLength && frameLength > 0) {
-            long long unsigned int ts = (long long unsigned int) TimerGetMillis();
-            LogRawDebug(LOG_SOURCE_BT, "[%llu] DEBUG: BM83: RX: ", ts);
-            uint16_t frameSize = frameLength + BM83_FRAME_CTRL_BYTE_COUNT;
-            uint16_t dataLength = frameLength - 1;
-            uint8_t eventData[dataLength];
-            memset(eventData, 0, dataLength);
-            uint8_t event = 0x00;
-            uint16_t i = 0;
-            uint16_t j = 0;
-            // lastIdx is the index of the checksum
-            uint16_t lastIdx = frameSize - 1;
-            // Get the data
-            for (i = 0; i < frameSize; i++) {
-                uint8_t byte = CharQueueNext(&bt->uart.rxQueue);
-                LogRawDebug(LOG_SOURCE_BT, "%02X ", byte);
-                if (i == BM83_OFFSET_EVENT_CODE) {
-                    event = byte;
-                }
-                if (i >= BM83_OFFSET_EVENT_DATA &&
-                    i < lastIdx
-                ) {
-                    eventData[j] = byte;
-                    j++;
+    CharQueueNext(queue);
+    parser->trashedBytes++;
+    parser->state = BM83_RX_STATE_SYNC;
+}
+
+/**
+ * BM83FrameSeek()
+ *     Description:
+ *         Advance the frame parser over the bytes that arrived since the last
+ *         call. Bytes before a start word are dropped. A frame with an
+ *         invalid length or checksum, or one that stops arriving, has its
+ *         start word dropped so that parsing resumes from the next one.
+ *     Params:
+ *         BM83FrameParser_t *parser - The parser state
+ *         volatile CharQueue_t *queue - The RX queue
+ *     Returns:
+ *         uint16_t - The size of the valid frame at the head of the queue,
+ *             control bytes included, or 0 if there is none yet
+ */
+uint16_t BM83FrameSeek(BM83FrameParser_t *parser, volatile CharQueue_t *queue)
+{
+    uint16_t size = CharQueueGetSize(queue);
+    uint32_t now = TimerGetMillis();
+    uint16_t trashed = 0;
+    uint8_t trash[BM83_RX_TRASH_LOG_SIZE];
+    uint16_t frameSize = 0;
+    while (size > 0 && frameSize == 0) {
+        if (parser->state == BM83_RX_STATE_SYNC) {
+            if (CharQueueGetOffset(queue, 0) != BM83_UART_START_WORD) {
+                uint8_t byte = CharQueueNext(queue);
+                if (trashed < BM83_RX_TRASH_LOG_SIZE) {
+                    trash[trashed] = byte;
                 }
+                parser->trashedBytes++;
+                trashed++;
+                size--;
+                continue;
             }
-            LogRawDebug(LOG_SOURCE_BT, "\r\n");
-            // Always acknowledge reception of the frame first
-            if (event != BM83_EVT_COMMAND_ACK) {
-                uint8_t ack[] = {BM83_CMD_EVENT_ACK, event};
-                BM83SendCommand(bt, ack, sizeof(ack));
-            }
-            if (event == BM83_EVT_AVC_SPECIFIC_RSP) {
-                BM83ProcessEventAVCSpecificRsp(bt, eventData, dataLength);
+            parser->state = BM83_RX_STATE_LENGTH_HIGH;
+            parser->checksum = 0;
+            parser->length = 0;
+            parser->offset = 1;
+            parser->timestamp = now;
+        }
+        if (parser->offset >= size) {
+            if (now - parser->timestamp < BM83_RX_FRAME_TIMEOUT) {
+                break;
             }
-            if (event == BM83_EVT_AVRCP_VENDOR_DEPENDENT_RSP) {
-                BM83ProcessEventAVCVendorDependentRsp(bt, eventData, dataLength);
+            LogWarning("BT: BM83 frame timed out");
+            BM83FrameResync(parser, queue);
+            size--;
+            continue;
+        }
+        uint8_t byte = CharQueueGetOffset(queue, parser->offset);
+        parser->checksum += byte;
+        parser->offset++;
+        parser->timestamp = now;
+        if (parser->state == BM83_RX_STATE_LENGTH_HIGH) {
+            parser->length = byte << 8;
+            parser->state = BM83_RX_STATE_LENGTH_LOW;
+        } else if (parser->state == BM83_RX_STATE_LENGTH_LOW) {
+            parser->length = parser->length | byte;
+            if (parser->length == 0 ||
+                parser->length > BM83_RX_FRAME_LENGTH_MAX
+            ) {
+                BM83FrameResync(parser, queue);
+                size--;
+            } else {
+                parser->state = BM83_RX_STATE_DATA;
             }
-            if (event == BM83_EVT_BTM_STATUS) {
-                BM83ProcessEventBTMStatus(bt, eventData, dataLength);
+        } else if (parser->offset == parser->length + BM83_FRAME_CTRL_BYTE_COUNT) {
+            // The checksum makes the sum of all bytes after the start word 0
+            if (parser->checksum == 0) {
+                parser->state = BM83_RX_STATE_SYNC;
+                frameSize = parser->offset;
+                continue;
             }
-            if (event == BM83_EVT_CALL_STATUS) {
-                BM83ProcessEventCallStatus(bt, eventData, dataLength);
+            LogWarning("BT: BM83 frame checksum mismatch");
+            parser->badChecksums++;
+            BM83FrameResync(parser, queue);
+            size--;
+        }
+    }
+    if (trashed != 0) {
+        uint16_t dumped = trashed;
+        if (dumped > BM83_RX_TRASH_LOG_SIZE) {
+            dumped = BM83_RX_TRASH_LOG_SIZE;
+        }
+        LogRawDebug(
+            LOG_SOURCE_BT,
+            "BT: Trash Bytes [%u]: %s\r\n",
+            trashed,
+            LogHex(trash, dumped)
+        );
+    }
+    return frameSize;
+}
+
+/**
+ * BM83GetFrameParser()
+ *     Description:
+ *         Get the RX frame parser, for its counters
+ *     Params:
+ *         None
+ *     Returns:
+ *         BM83FrameParser_t * - The parser state
+ */
+BM83FrameParser_t *BM83GetFrameParser()
+{
+    return &BM83RXFrame;
+}
+
+/**
+ * BM83MetadataCacheGetStats()
+ *     Description:
+ *         Get the metadata cache counters
+ *     Params:
+ *         None
+ *     Returns:
+ *         BM83MetadataCacheStats_t * - The counters
+ */
+BM83MetadataCacheStats_t *BM83MetadataCacheGetStats()
+{
+    return &BM83MetadataCacheStats;
+}
+
+/**
+ * BM83SendFrame()
+ *     Description:
+ *         Wrap the given command in a frame and send it over UART
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint8_t *targetData - A command to send along with its data
+ *         size_t size - The target length of the frame
+ *     Returns:
+ *         void
+ */
+static void BM83SendFrame(BT_t *bt, uint8_t *targetData, size_t size)
+{
+    uint8_t idx = 0;
+    uint16_t frameSize = size + BM83_FRAME_CTRL_BYTE_COUNT;
+    uint8_t frame[frameSize];
+    memset(frame, 0, frameSize);
+    uint8_t checksum = 0xFF;
+    frame[0] = BM83_UART_START_WORD;
+    frame[1] = 0x00;
+    frame[2] = size;
+    checksum = checksum - size;
+    for (idx = 0; idx < size; idx++) {
+        frame[idx + 3] = targetData[idx];
+        checksum = checksum - targetData[idx];
+    }
+    checksum++;
+    frame[frameSize - 1] = checksum;
+    long long unsigned int ts = LogGetTimestamp();
+    LogRawDebug(
+        LOG_SOURCE_BT,
+        "[%llu] DEBUG: BM83: TX: %s\r\n",
+        ts,
+        LogHex(frame, frameSize)
+    );
+    UARTSendData(&bt->uart, frame, frameSize);
+}
+
+/**
+ * BM83CommandQueueGetOpcodeStats()
+ *     Description:
+ *         Get the counters of the given opcode, claiming a free slot for it
+ *         if it has none yet
+ *     Params:
+ *         uint8_t opcode - The command opcode
+ *     Returns:
+ *         BM83CommandStats_t * - The counters, or 0 if the table is full
+ */
+static BM83CommandStats_t *BM83CommandQueueGetOpcodeStats(uint8_t opcode)
+{
+    uint8_t idx = 0;
+    for (idx = 0; idx < BM83CommandQueueStatsCount; idx++) {
+        if (BM83CommandQueueStats[idx].opcode == opcode) {
+            return &BM83CommandQueueStats[idx];
+        }
+    }
+    if (BM83CommandQueueStatsCount == BM83_CMD_STATS_SIZE) {
+        return 0;
+    }
+    BM83CommandStats_t *stats = &BM83CommandQueueStats[BM83CommandQueueStatsCount++];
+    memset(stats, 0, sizeof(BM83CommandStats_t));
+    stats->opcode = opcode;
+    return stats;
+}
+
+/**
+ * BM83CommandQueueRemove()
+ *     Description:
+ *         Remove the command at the given position, keeping the remaining
+ *         commands in the order they were queued
+ *     Params:
+ *         uint8_t position - The position of the command in the queue
+ *     Returns:
+ *         void
+ */
+static void BM83CommandQueueRemove(uint8_t position)
+{
+    uint8_t idx = 0;
+    for (idx = position; idx < BM83CommandQueueDepth - 1; idx++) {
+        BM83CommandQueue[idx] = BM83CommandQueue[idx + 1];
+    }
+    BM83CommandQueueDepth--;
+}
+
+/**
+ * BM83CommandQueueRetry()
+ *     Description:
+ *         Schedule the command at the given position to be sent again, or
+ *         drop it once it has run out of retries
+ *     Params:
+ *         uint8_t position - The position of the command in the queue
+ *     Returns:
+ *         void
+ */
+static void BM83CommandQueueRetry(uint8_t position)
+{
+    BM83Command_t *command = &BM83CommandQueue[position];
+    BM83CommandStats_t *stats = BM83CommandQueueGetOpcodeStats(command->data[0]);
+    if (command->retries < BM83_CMD_MAX_RETRIES) {
+        command->retries++;
+        command->status = BM83_CMD_STATUS_PENDING;
+        command->timestamp = TimerGetMillis();
+        if (stats != 0) {
+            stats->retries++;
+        }
+    } else {
+        LogError(
+            "BT: BM83 command %02X dropped after %d retries",
+            command->data[0],
+            command->retries
+        );
+        if (stats != 0) {
+            stats->failures++;
+        }
+        BM83CommandQueueRemove(position);
+    }
+}
+
+/**
+ * BM83CommandQueueAck()
+ *     Description:
+ *         Match a command ACK to the oldest command sent with its opcode, and
+ *         complete, retry or drop that command based on the ACK status
+ *     Params:
+ *         uint8_t opcode - The opcode that the module acknowledged
+ *         uint8_t status - See BM83_CMD_ACK_STATUS_*
+ *     Returns:
+ *         void
+ */
+static void BM83CommandQueueAck(uint8_t opcode, uint8_t status)
+{
+    uint8_t position = 0;
+    while (position < BM83CommandQueueDepth) {
+        if (BM83CommandQueue[position].status == BM83_CMD_STATUS_SENT &&
+            BM83CommandQueue[position].data[0] == opcode
+        ) {
+            break;
+        }
+        position++;
+    }
+    if (position == BM83CommandQueueDepth) {
+        LogDebug(LOG_SOURCE_BT, "BT: Unexpected BM83 ACK for %02X", opcode);
+        return;
+    }
+    BM83Command_t *command = &BM83CommandQueue[position];
+    BM83CommandStats_t *stats = BM83CommandQueueGetOpcodeStats(opcode);
+    if (status == BM83_CMD_ACK_STATUS_COMPLETE) {
+        uint32_t latency = TimerGetMillis() - command->timestamp;
+        if (stats != 0) {
+            stats->completed++;
+            stats->latencyLast = latency;
+            stats->latencyTotal += latency;
+            if (latency > stats->latencyMax) {
+                stats->latencyMax = latency;
             }
-            if (event == BM83_EVT_CALLER_ID) {
-                BM83ProcessEventCallerID(bt, eventData, dataLength);
+        }
+        BM83CommandQueueRemove(position);
+    } else if (status == BM83_CMD_ACK_STATUS_BUSY ||
+        status == BM83_CMD_ACK_STATUS_MEMORY_FULL
+    ) {
+        BM83CommandQueueRetry(position);
+    } else {
+        // The module will refuse the command again, so do not resend it
+        LogWarning("BT: BM83 command %02X refused (%02X)", opcode, status);
+        if (stats != 0) {
+            stats->failures++;
+        }
+        BM83CommandQueueRemove(position);
+    }
+}
+
+/**
+ * BM83CommandQueueSend()
+ *     Description:
+ *         Send the pending commands, in the order they were queued, until
+ *         BM83_CMD_MAX_IN_FLIGHT commands are waiting for their ACK
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+static void BM83CommandQueueSend(BT_t *bt)
+{
+    uint32_t now = TimerGetMillis();
+    uint8_t inFlight = 0;
+    uint8_t idx = 0;
+    for (idx = 0; idx < BM83CommandQueueDepth; idx++) {
+        if (BM83CommandQueue[idx].status == BM83_CMD_STATUS_SENT) {
+            inFlight++;
+        }
+    }
+    for (idx = 0; idx < BM83CommandQueueDepth; idx++) {
+        BM83Command_t *command = &BM83CommandQueue[idx];
+        if (inFlight >= BM83_CMD_MAX_IN_FLIGHT) {
+            return;
+        }
+        if (command->status == BM83_CMD_STATUS_PENDING) {
+            // Commands after a refused one wait for it to be sent again
+            if (command->retries > 0 &&
+                now - command->timestamp < BM83_CMD_RETRY_DELAY
+            ) {
+                return;
             }
-            if (event == BM83_EVT_READ_LINK_STATUS_REPLY) {
-                BM83ProcessEventReadLinkStatus(bt, eventData, dataLength);
+            command->status = BM83_CMD_STATUS_SENT;
+            command->timestamp = now;
+            BM83SendFrame(bt, command->data, command->length);
+            inFlight++;
+        }
+    }
+}
+
+/**
+ * BM83CommandQueueProcess()
+ *     Description:
+ *         Retry the commands that were not acknowledged in time and send
+ *         the pending ones
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+static void BM83CommandQueueProcess(BT_t *bt)
+{
+    uint32_t now = TimerGetMillis();
+    uint8_t idx = 0;
+    while (idx < BM83CommandQueueDepth) {
+        BM83Command_t *command = &BM83CommandQueue[idx];
+        if (command->status == BM83_CMD_STATUS_SENT &&
+            now - command->timestamp >= BM83_CMD_ACK_TIMEOUT
+        ) {
+            LogWarning("BT: BM83 command %02X timed out", command->data[0]);
+            uint8_t depth = BM83CommandQueueDepth;
+            BM83CommandQueueRetry(idx);
+            if (BM83CommandQueueDepth != depth) {
+                // The command was dropped, so idx now holds the next one
+                continue;
             }
-            if (event == BM83_EVT_READ_LINKED_DEVICE_INFORMATION_REPLY) {
-                BM83ProcessEventReadLinkedDeviceInformation(
-                    bt,
-                    eventData,
-                    dataLength
-                );
+        }
+        idx++;
+    }
+    BM83CommandQueueSend(bt);
+}
+
+/**
+ * BM83CommandQueueGetDepth()
+ *     Description:
+ *         Get the number of commands that are queued or waiting for an ACK
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - The number of commands in the queue
+ */
+uint8_t BM83CommandQueueGetDepth()
+{
+    return BM83CommandQueueDepth;
+}
+
+/**
+ * BM83CommandQueueGetStats()
+ *     Description:
+ *         Get the ACK counters of an opcode that has been sent
+ *     Params:
+ *         uint8_t idx - The index of the counters, starting at zero
+ *     Returns:
+ *         BM83CommandStats_t * - The counters, or 0 past the last opcode
+ */
+BM83CommandStats_t *BM83CommandQueueGetStats(uint8_t idx)
+{
+    if (idx >= BM83CommandQueueStatsCount) {
+        return 0;
+    }
+    return &BM83CommandQueueStats[idx];
+}
+
+/**
+ * BM83Process()
+ *     Description:
+ *         Read the RX queue and process the messages into meaningful data
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+void BM83Process(BT_t *bt)
+{
+    uint16_t frameSize = BM83FrameSeek(&BM83RXFrame, &bt->uart.rxQueue);
+    if (frameSize != 0) {
+        uint16_t frameLength = frameSize - BM83_FRAME_CTRL_BYTE_COUNT;
+        uint16_t dataLength = frameLength - 1;
+        uint8_t eventData[dataLength];
+        memset(eventData, 0, dataLength);
+        uint8_t event = 0x00;
+        uint8_t header[BM83_OFFSET_EVENT_DATA];
+        uint8_t checksum = 0x00;
+        uint16_t i = 0;
+        uint16_t j = 0;
+        // lastIdx is the index of the checksum
+        uint16_t lastIdx = frameSize - 1;
+        // Get the data
+        for (i = 0; i < frameSize; i++) {
+            uint8_t byte = CharQueueNext(&bt->uart.rxQueue);
+            if (i < BM83_OFFSET_EVENT_DATA) {
+                header[i] = byte;
             }
-            if (event == BM83_EVT_READ_PAIRED_DEVICE_RECORD_REPLY) {
-                BM83ProcessEventReadPairedDeviceRecord(
-                    bt,
-                    eventData,
-                    dataLength
-                );
+            if (i == BM83_OFFSET_EVENT_CODE) {
+                event = byte;
             }
-            if (event == BM83_EVT_READ_LOCAL_BD_ADDRESS_REPLY) {
-                if (dataLength == 0x06) {
-                    uint8_t data[6] = {
-                        eventData[5],
-                        eventData[4],
-                        eventData[3],
-                        eventData[2],
-                        eventData[1],
-                        eventData[0]
-                    };
-                    EventTriggerCallback(BT_EVENT_BTM_ADDRESS, data);
-                }
+            if (i >= BM83_OFFSET_EVENT_DATA &&
+                i < lastIdx
+            ) {
+                eventData[j] = byte;
+                j++;
             }
-            if (event == BM83_EVT_REPORT_BTM_INITIAL_STATUS) {
-                if (eventData[BM83_FRAME_DB0] ==
-                    BM83_DATA_BTM_INITIAL_STATUS_BOOT_COMPLETE
-                ) {
-                    EventTriggerCallback(BT_EVENT_BOOT, 0);
-                }
+            if (i == lastIdx) {
+                checksum = byte;
             }
-            if (event == BM83_EVT_REPORT_LINK_BACK_STATUS) {
-                BM83ProcessEventReportLinkBackStatus(
-                    bt,
-                    eventData,
-                    dataLength
-                );
+        }
+        long long unsigned int ts = LogGetTimestamp();
+        // The frame is not kept whole, so dump the event data between the
+        // control bytes
+        LogRawDebug(
+            LOG_SOURCE_BT,
+            "[%llu] DEBUG: BM83: RX: %02X %02X %02X %02X %s%s%02X\r\n",
+            ts,
+            header[0],
+            header[1],
+            header[2],
+            header[BM83_OFFSET_EVENT_CODE],
+            LogHex(eventData, dataLength),
+            dataLength > 0 ? " " : "",
+            checksum
+        );
+        // Trace the event code followed by the start of its data
+        uint8_t trace[TRACE_EVENT_DATA_SIZE] = {event};
+        if (dataLength < TRACE_EVENT_DATA_SIZE) {
+            memcpy(&trace[1], eventData, dataLength);
+        } else {
+            memcpy(&trace[1], eventData, TRACE_EVENT_DATA_SIZE - 1);
+        }
+        TraceEvent(TRACE_EVENT_BT_RX, trace, frameLength);
+        // Always acknowledge reception of the frame first
+        if (event != BM83_EVT_COMMAND_ACK) {
+            uint8_t ack[] = {BM83_CMD_EVENT_ACK, event};
+            BM83SendCommand(bt, ack, sizeof(ack));
+        } else if (dataLength >= 2) {
+            BM83CommandQueueAck(
+                eventData[BM83_FRAME_DB0],
+                eventData[BM83_FRAME_DB1]
+            );
+        }
+        if (event == BM83_EVT_AVC_SPECIFIC_RSP) {
+            BM83ProcessEventAVCSpecificRsp(bt, eventData, dataLength);
+        }
+        if (event == BM83_EVT_AVRCP_VENDOR_DEPENDENT_RSP) {
+            BM83ProcessEventAVCVendorDependentRsp(bt, eventData, dataLength);
+        }
+        if (event == BM83_EVT_BTM_STATUS) {
+            BM83ProcessEventBTMStatus(bt, eventData, dataLength);
+        }
+        if (event == BM83_EVT_CALL_STATUS) {
+            BM83ProcessEventCallStatus(bt, eventData, dataLength);
+        }
+        if (event == BM83_EVT_CALLER_ID) {
+            BM83ProcessEventCallerID(bt, eventData, dataLength);
+        }
+        if (event == BM83_EVT_READ_LINK_STATUS_REPLY) {
+            BM83ProcessEventReadLinkStatus(bt, eventData, dataLength);
+        }
+        if (event == BM83_EVT_READ_LINKED_DEVICE_INFORMATION_REPLY) {
+            BM83ProcessEventReadLinkedDeviceInformation(
+                bt,
+                eventData,
+                dataLength
+            );
+        }
+        if (event == BM83_EVT_READ_PAIRED_DEVICE_RECORD_REPLY) {
+            BM83ProcessEventReadPairedDeviceRecord(
+                bt,
+                eventData,
+                dataLength
+            );
+        }
+        if (event == BM83_EVT_READ_LOCAL_BD_ADDRESS_REPLY) {
+            if (dataLength == 0x06) {
+                uint8_t data[6] = {
+                    eventData[5],
+                    eventData[4],
+                    eventData[3],
+                    eventData[2],
+                    eventData[1],
+                    eventData[0]
+                };
+                EventTriggerCallback(BT_EVENT_BTM_ADDRESS, data);
             }
-            if (event == BM83_EVT_REPORT_TYPE_CODEC) {
-                BM83ProcessEventReportTypeCodec(bt, eventData, dataLength);
+        }
+        if (event == BM83_EVT_REPORT_BTM_INITIAL_STATUS) {
+            if (eventData[BM83_FRAME_DB0] ==
+                BM83_DATA_BTM_INITIAL_STATUS_BOOT_COMPLETE
+            ) {
+                EventTriggerCallback(BT_EVENT_BOOT, 0);
             }
         }
+        if (event == BM83_EVT_REPORT_LINK_BACK_STATUS) {
+            BM83ProcessEventReportLinkBackStatus(
+                bt,
+                eventData,
+                dataLength
+            );
+        }
+        if (event == BM83_EVT_REPORT_TYPE_CODEC) {
+            BM83ProcessEventReportTypeCodec(bt, eventData, dataLength);
+        }
     }
+    BM83CommandQueueProcess(bt);
     UARTReportErrors(&bt->uart);
 }
 
 /**
  * BM83SendCommand()
  *     Description:
- *         Send data over UART
+ *         Queue a command to be sent over UART. It is sent again if the
+ *         module does not acknowledge it in time or reports that it is busy.
+ *         Event ACKs are sent right away since the module does not ACK them.
  *     Params:
  *         BT_t *bt - A pointer to the module object
  *         uint8_t *targetData - A command to send along with its data
@@ -1352,30 +2102,27 @@ void BM83SendCommand(
     uint8_t *targetData,
     size_t size
 ) {
-    uint8_t idx = 0;
-    long long unsigned int ts = (long long unsigned int) TimerGetMillis();
-    LogRawDebug(
-        LOG_SOURCE_BT,
-        "[%llu] DEBUG: BM83: TX: AA 00 ",
-        ts
-    );
-    uint16_t frameSize = size + BM83_FRAME_CTRL_BYTE_COUNT;
-    uint8_t frame[frameSize];
-    memset(frame, 0, frameSize);
-    uint8_t checksum = 0xFF;
-    frame[0] = BM83_UART_START_WORD;
-    frame[1] = 0x00;
-    frame[2] = size;
-    // Send the length
-    LogRawDebug(LOG_SOURCE_BT, "%02X ", size);
-    checksum = checksum - size;
-    for (idx = 0; idx < size; idx++) {
-        frame[idx + 3] = targetData[idx];
-        checksum = checksum - targetData[idx];
-        LogRawDebug(LOG_SOURCE_BT, "%02X ", targetData[idx]);
+    if (targetData[0] == BM83_CMD_EVENT_ACK) {
+        BM83SendFrame(bt, targetData, size);
+        return;
     }
-    checksum++;
-    LogRawDebug(LOG_SOURCE_BT, "%02X\r\n", checksum);
-    frame[frameSize - 1] = checksum;
-    UARTSendData(&bt->uart, frame, frameSize);
+    if (size > BM83_CMD_QUEUE_DATA_SIZE) {
+        LogError("BT: BM83 command %02X is too long", targetData[0]);
+        return;
+    }
+    if (BM83CommandQueueDepth == BM83_CMD_QUEUE_SIZE) {
+        LogError("BT: BM83 command queue full, dropping %02X", targetData[0]);
+        BM83CommandStats_t *stats = BM83CommandQueueGetOpcodeStats(targetData[0]);
+        if (stats != 0) {
+            stats->failures++;
+        }
+        return;
+    }
+    BM83Command_t *command = &BM83CommandQueue[BM83CommandQueueDepth++];
+    memcpy(command->data, targetData, size);
+    command->length = size;
+    command->status = BM83_CMD_STATUS_PENDING;
+    command->retries = 0;
+    command->timestamp = 0;
+    BM83CommandQueueSend(bt);
 }
@@ -18,6 +18,10 @@ extern int8_t BTBM83MicGainTable[];
 #define BM83_AVRCP_DATA_ELEMENT_TYPE_ARTIST 0x02
 #define BM83_AVRCP_DATA_ELEMENT_TYPE_ALBUM 0x03
 #define BM83_AVRCP_DATA_CAP_TYPE_EVENTS 0x03
+// Attribute ID (4), character set (2) and length (2) precede the text
+#define BM83_AVRCP_ATTRIBUTE_HEADER_SIZE 8
+#define BM83_AVRCP_ATTRIBUTE_OFFSET_ID 3
+#define BM83_AVRCP_ATTRIBUTE_OFFSET_LENGTH 6
 
 #define BM83_AVRCP_EVT_PLAYBACK_STATUS_CHANGED 0x01
 #define BM83_AVRCP_EVT_PLAYBACK_TRACK_CHANGED 0x02
@@ -310,6 +314,152 @@ extern int8_t BTBM83MicGainTable[];
 #define BM83_EVT_RUNTIME 0x5E
 
 #define BM83_UART_START_WORD 0xAA
+/* Frame Parser */
+#define BM83_RX_STATE_SYNC 0
+#define BM83_RX_STATE_LENGTH_HIGH 1
+#define BM83_RX_STATE_LENGTH_LOW 2
+#define BM83_RX_STATE_DATA 3
+// Give up on a frame if its remaining bytes do not arrive in time
+#define BM83_RX_FRAME_TIMEOUT 50
+// Trashed bytes beyond this are counted, but not dumped
+#define BM83_RX_TRASH_LOG_SIZE 16
+// Longer frames can never fit in the RX queue, so the length is corrupt
+#define BM83_RX_FRAME_LENGTH_MAX (CHAR_QUEUE_SIZE - BM83_FRAME_CTRL_BYTE_COUNT - 1)
+
+/**
+ * BM83FrameParser_t
+ *     Description:
+ *         Tracks the frame at the head of the RX queue while its bytes
+ *         arrive. The bytes stay in the queue until the frame is complete.
+ *     Fields:
+ *         state - See BM83_RX_STATE_*
+ *         checksum - The sum of the frame bytes after the start word
+ *         length - The length of the frame, from its header
+ *         offset - The number of frame bytes examined so far
+ *         timestamp - The last time a frame byte was examined
+ *         badChecksums - Frames dropped since their checksum was invalid
+ *         trashedBytes - Bytes dropped while looking for a start word
+ */
+typedef struct BM83FrameParser_t {
+    uint8_t state;
+    uint8_t checksum;
+    uint16_t length;
+    uint16_t offset;
+    uint32_t timestamp;
+    uint32_t badChecksums;
+    uint32_t trashedBytes;
+} BM83FrameParser_t;
+
+/* Command Queue */
+#define BM83_CMD_QUEUE_SIZE 8
+// The largest command we send is a dial request with a 19 digit number
+#define BM83_CMD_QUEUE_DATA_SIZE 24
+// Commands sent before the previous ones are acknowledged. Keep it at one so
+// that a retransmitted command can never overtake the command after it.
+#define BM83_CMD_MAX_IN_FLIGHT 1
+#define BM83_CMD_ACK_TIMEOUT 200
+// Give a busy module some time before sending the command again
+#define BM83_CMD_RETRY_DELAY 20
+#define BM83_CMD_MAX_RETRIES 3
+#define BM83_CMD_STATS_SIZE 16
+#define BM83_CMD_STATUS_PENDING 0
+#define BM83_CMD_STATUS_SENT 1
+#define BM83_CMD_ACK_STATUS_COMPLETE 0x00
+#define BM83_CMD_ACK_STATUS_DISALLOWED 0x01
+#define BM83_CMD_ACK_STATUS_UNKNOWN_COMMAND 0x02
+#define BM83_CMD_ACK_STATUS_INVALID_PARAMETER 0x03
+#define BM83_CMD_ACK_STATUS_BUSY 0x04
+#define BM83_CMD_ACK_STATUS_MEMORY_FULL 0x05
+
+/**
+ * BM83Command_t
+ *     Description:
+ *         A command waiting in the queue, or waiting for its acknowledgement
+ *     Fields:
+ *         data - The command opcode followed by its parameters
+ *         length - The number of bytes in data
+ *         status - See BM83_CMD_STATUS_*
+ *         retries - The number of times the command was sent again
+ *         timestamp - The last time the command was sent or refused
+ */
+typedef struct BM83Command_t {
+    uint8_t data[BM83_CMD_QUEUE_DATA_SIZE];
+    uint8_t length;
+    uint8_t status;
+    uint8_t retries;
+    uint32_t timestamp;
+} BM83Command_t;
+
+/**
+ * BM83CommandStats_t
+ *     Description:
+ *         Acknowledgement counters for a single opcode
+ *     Fields:
+ *         opcode - The command opcode
+ *         completed - Commands that the module accepted
+ *         failures - Commands dropped after being refused or timing out
+ *         retries - Commands sent again after being refused or timing out
+ *         latencyLast - The time between the last send and its ACK in ms
+ *         latencyMax - The longest time between a send and its ACK in ms
+ *         latencyTotal - The sum of all latencies, for the average
+ */
+typedef struct BM83CommandStats_t {
+    uint8_t opcode;
+    uint16_t completed;
+    uint16_t failures;
+    uint16_t retries;
+    uint16_t latencyLast;
+    uint16_t latencyMax;
+    uint32_t latencyTotal;
+} BM83CommandStats_t;
+
+/* Metadata Cache */
+// Every entry holds a copy of the three metadata fields, so keep this small
+#define BM83_METADATA_CACHE_SIZE 3
+// Do not ask for the metadata again while a request is still unanswered
+#define BM83_METADATA_REQUEST_TIMEOUT 1000
+#define BM83_AVRCP_TRACK_UID_SIZE 8
+
+/**
+ * BM83MetadataCacheEntry_t
+ *     Description:
+ *         The normalized metadata of a recently played track
+ *     Fields:
+ *         hash - The hash of the raw attributes that the fields came from
+ *         uid - The AVRCP track UID, or zeros if the player did not send one
+ *         fields - The fields held by the entry, see BT_METADATA_FIELD_*.
+ *             An entry without fields is unused.
+ *         lastUsed - The cache clock when the entry was last used
+ *         title - The normalized title
+ *         artist - The normalized artist
+ *         album - The normalized album
+ */
+typedef struct BM83MetadataCacheEntry_t {
+    uint32_t hash;
+    uint8_t uid[BM83_AVRCP_TRACK_UID_SIZE];
+    uint8_t fields;
+    uint32_t lastUsed;
+    char title[BT_METADATA_FIELD_SIZE];
+    char artist[BT_METADATA_FIELD_SIZE];
+    char album[BT_METADATA_FIELD_SIZE];
+} BM83MetadataCacheEntry_t;
+
+/**
+ * BM83MetadataCacheStats_t
+ *     Description:
+ *         Metadata cache counters
+ *     Fields:
+ *         hits - Responses whose attributes were already in the cache
+ *         misses - Responses that had to be normalized
+ *         trackHits - Requests answered from the cache by the track UID
+ *         suppressed - Requests skipped while another one was unanswered
+ */
+typedef struct BM83MetadataCacheStats_t {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t trackHits;
+    uint32_t suppressed;
+} BM83MetadataCacheStats_t;
 
 /* Define commands */
 void BM83CommandAVRCPGetCapabilities(BT_t *);
@@ -349,8 +499,13 @@ void BM83ProcessEventReadLinkedDeviceInformation(BT_t *, uint8_t *, uint16_t);
 void BM83ProcessEventReadPairedDeviceRecord(BT_t *, uint8_t *, uint16_t);
 void BM83ProcessEventReportLinkBackStatus(BT_t *, uint8_t *, uint16_t);
 void BM83ProcessEventReportTypeCodec(BT_t *, uint8_t *, uint16_t );
-void BM83ProcessDataGetAllAttributes(BT_t *, uint8_t *, uint8_t, uint16_t);
+void BM83ProcessDataGetAllAttributes(BT_t *, uint8_t *, uint8_t, uint16_t, uint16_t);
 /* RX / TX */
+uint8_t BM83CommandQueueGetDepth();
+BM83CommandStats_t *BM83CommandQueueGetStats(uint8_t);
+uint16_t BM83FrameSeek(BM83FrameParser_t *, volatile CharQueue_t *);
+BM83FrameParser_t *BM83GetFrameParser();
+BM83MetadataCacheStats_t *BM83MetadataCacheGetStats();
 void BM83Process(BT_t *);
 void BM83SendCommand(BT_t *, uint8_t *, size_t);
 
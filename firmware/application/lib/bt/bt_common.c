@@ -35,6 +35,9 @@ void BTClearMetadata(BT_t *bt)
     memset(bt->title, 0, BT_METADATA_FIELD_SIZE);
     memset(bt->artist, 0, BT_METADATA_FIELD_SIZE);
     memset(bt->album, 0, BT_METADATA_FIELD_SIZE);
+    bt->metadataChanged = 0;
+    bt->metadataReceived = 0;
+    bt->metadataTrackChangeTimestamp = 0;
 }
 
 /**
@@ -90,6 +93,163 @@ BTConnection_t BTConnectionInit()
 }
 
 
+/**
+ * BTMetadataGetField()
+ *     Description:
+ *         Get the buffer that holds the given metadata field
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint8_t field - The field, see BT_METADATA_FIELD_*
+ *     Returns:
+ *         char * - The field buffer, BT_METADATA_FIELD_SIZE bytes long
+ */
+static char *BTMetadataGetField(BT_t *bt, uint8_t field)
+{
+    if (field == BT_METADATA_FIELD_ARTIST) {
+        return bt->artist;
+    } else if (field == BT_METADATA_FIELD_ALBUM) {
+        return bt->album;
+    }
+    return bt->title;
+}
+
+/**
+ * BTMetadataProcess()
+ *     Description:
+ *         Publish the metadata once every field of the track was received,
+ *         or once BT_METADATA_SETTLE_TIME passed since the first field. A
+ *         single BT_EVENT_METADATA_UPDATE is triggered with the mask of the
+ *         fields that changed, if any did.
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+void BTMetadataProcess(BT_t *bt)
+{
+    if (bt->metadataReceived == 0) {
+        return;
+    }
+    if (bt->metadataReceived != BT_METADATA_FIELD_ALL &&
+        TimerGetMillis() - bt->metadataSettleTimestamp < BT_METADATA_SETTLE_TIME
+    ) {
+        return;
+    }
+    uint8_t fields = bt->metadataChanged;
+    // A new title is a new track, so the fields it came without are stale
+    if ((fields & BT_METADATA_FIELD_TITLE) != 0) {
+        if ((bt->metadataReceived & BT_METADATA_FIELD_ARTIST) == 0 &&
+            bt->artist[0] != 0
+        ) {
+            memset(bt->artist, 0, BT_METADATA_FIELD_SIZE);
+            fields |= BT_METADATA_FIELD_ARTIST;
+        }
+        if ((bt->metadataReceived & BT_METADATA_FIELD_ALBUM) == 0 &&
+            bt->album[0] != 0
+        ) {
+            memset(bt->album, 0, BT_METADATA_FIELD_SIZE);
+            fields |= BT_METADATA_FIELD_ALBUM;
+        }
+    }
+    bt->metadataChanged = 0;
+    bt->metadataReceived = 0;
+    if (bt->metadataTrackChangeTimestamp != 0) {
+        uint32_t latency = TimerGetMillis() - bt->metadataTrackChangeTimestamp;
+        bt->metadataTrackChangeTimestamp = 0;
+        bt->metadataLatencyLast = latency;
+        if (latency > bt->metadataLatencyMax) {
+            bt->metadataLatencyMax = latency;
+        }
+        LogDebug(LOG_SOURCE_BT, "BT: Track change to metadata in %lu ms", latency);
+    }
+    if (fields != 0) {
+        LogDebug(
+            LOG_SOURCE_BT,
+            "BT: title=%s,artist=%s,album=%s (%02X)",
+            bt->title,
+            bt->artist,
+            bt->album,
+            fields
+        );
+        EventTriggerCallback(BT_EVENT_METADATA_UPDATE, &fields);
+    }
+}
+
+/**
+ * BTMetadataSetField()
+ *     Description:
+ *         Normalize and store a metadata field. The change is published
+ *         together with the other fields of the track by BTMetadataProcess()
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint8_t field - The field, see BT_METADATA_FIELD_*
+ *         const char *value - The field as sent by the device
+ *     Returns:
+ *         void
+ */
+void BTMetadataSetField(BT_t *bt, uint8_t field, const char *value)
+{
+    BTMetadataSetFieldLength(bt, field, value, strlen(value));
+}
+
+/**
+ * BTMetadataSetFieldLength()
+ *     Description:
+ *         Normalize the given bytes straight into a metadata field. The
+ *         field is compared by hash before and after, so that no copy of it
+ *         is needed to tell whether it changed.
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint8_t field - The field, see BT_METADATA_FIELD_*
+ *         const char *value - The field as sent by the device
+ *         uint16_t length - The number of bytes in value
+ *     Returns:
+ *         void
+ */
+void BTMetadataSetFieldLength(
+    BT_t *bt,
+    uint8_t field,
+    const char *value,
+    uint16_t length
+) {
+    char *target = BTMetadataGetField(bt, field);
+    uint32_t hash = UtilsHash(target, strlen(target));
+    UtilsNormalizeTextLength(target, value, length, BT_METADATA_FIELD_SIZE);
+    if (bt->metadataReceived == 0) {
+        bt->metadataSettleTimestamp = TimerGetMillis();
+    }
+    bt->metadataReceived |= field;
+    if (UtilsHash(target, strlen(target)) != hash) {
+        bt->metadataChanged |= field;
+    }
+}
+
+/**
+ * BTMetadataSetNormalizedField()
+ *     Description:
+ *         Store a metadata field that is already normalized, such as one
+ *         taken from a metadata cache
+ *     Params:
+ *         BT_t *bt - A pointer to the module object
+ *         uint8_t field - The field, see BT_METADATA_FIELD_*
+ *         const char *text - The normalized field
+ *     Returns:
+ *         void
+ */
+void BTMetadataSetNormalizedField(BT_t *bt, uint8_t field, const char *text)
+{
+    char *target = BTMetadataGetField(bt, field);
+    if (bt->metadataReceived == 0) {
+        bt->metadataSettleTimestamp = TimerGetMillis();
+    }
+    bt->metadataReceived |= field;
+    if (strncmp(target, text, BT_METADATA_FIELD_SIZE) != 0) {
+        memset(target, 0, BT_METADATA_FIELD_SIZE);
+        UtilsStrncpy(target, text, BT_METADATA_FIELD_SIZE);
+        bt->metadataChanged |= field;
+    }
+}
+
 /**
  * BTPairedDeviceInit()
  *     Description:
@@ -9,10 +9,16 @@
 #include "../../mappings.h"
 #include "../log.h"
 #include "../event.h"
+#include "../trace.h"
+#include "../timer.h"
 #include "../uart.h"
+#include "../utils.h"
 
 #define BT_AVRCP_ACTION_GET_METADATA 0
-#define BT_AVRCP_ACTION_SET_TRACK_CHANGE_NOTIF 1
+#define BT_AVRCP_ACTION_REGISTER_NOTIFICATIONS 1
+#define BT_AVRCP_ACTION_GET_CAPABILITIES 2
+// AVRCP event IDs that fit in the avrcpNotifications bit masks
+#define BT_AVRCP_EVENT_COUNT 16
 
 #define BT_AVRCP_STATUS_PAUSED 0
 #define BT_AVRCP_STATUS_PLAYING 1
@@ -65,12 +71,13 @@
 #define BT_DEVICE_NAME_LEN 32
 #define BT_METADATA_MAX_SIZE 384
 #define BT_METADATA_FIELD_SIZE 128
-// BC127-specific
-#define BT_METADATA_STATUS_CUR 0
-#define BT_METADATA_STATUS_UPD 1
-// BM83-specific
-#define BT_METADATA_STATUS_SET 0
-#define BT_METADATA_STATUS_GET 1
+// Bitmask of the metadata fields, given with BT_EVENT_METADATA_UPDATE
+#define BT_METADATA_FIELD_TITLE 0x01
+#define BT_METADATA_FIELD_ARTIST 0x02
+#define BT_METADATA_FIELD_ALBUM 0x04
+#define BT_METADATA_FIELD_ALL 0x07
+// How long to collect the fields of a track before publishing them
+#define BT_METADATA_SETTLE_TIME 250
 
 #define BT_STATE_OFF 0
 #define BT_STATE_ON 1
@@ -118,6 +125,7 @@ typedef struct BTConnectionAVRCPCapabilities_t {
     uint8_t playbackPosChanged: 1;
     uint8_t nowPlayingChanged: 1;
     uint8_t volumeChanged: 1;
+    uint8_t addressedPlayerChanged: 1;
 } BTConnectionAVRCPCapabilities_t;
 
 /**
@@ -165,8 +173,15 @@ typedef struct BTConnection_t {
  *         type - BM83 or BC127
  *         connectable - The current connectable state (0 = Off, 1 = On)
  *         discoverable - The current discoverable state (0 = Off, 1 = On)
- *         avrcpStatus - The required AVRCP updates
- *         metadataStatus - Tracks if the metadata is new, so we can publish it
+ *         avrcpUpdates - The required AVRCP updates, see BT_AVRCP_ACTION_*
+ *         avrcpNotifications - The AVRCP events, one bit per event ID, that
+ *             we still have to register for
+ *         avrcpNotificationsArmed - The AVRCP events whose registration the
+ *             device confirmed, and that have not fired since
+ *         metadataChanged - The metadata fields that changed since they
+ *             were last published
+ *         metadataReceived - The metadata fields received since they were
+ *             last published
  *         playbackStatus - If we're paused or playing
  *         vrStatus- If Voice Recognition is on or off
  *         callStatus - The call status
@@ -178,6 +193,13 @@ typedef struct BTConnection_t {
  *             in error. This is used to track what profiles we need to re-attempt
  *             a connection with.
  *         metadataTimestamp - The last time we got metadata of any kind
+ *         metadataSettleTimestamp - The time the first unpublished metadata
+ *             field was received at
+ *         metadataTrackChangeTimestamp - The time the device notified us of
+ *             a track change whose metadata was not published yet
+ *         metadataLatencyLast - The time between the last track change and
+ *             the publication of its metadata in ms
+ *         metadataLatencyMax - The longest such time in ms
  *         rxQueueAge - Used to track how long data has been sitting on the
  *             RX queue without getting a MSG_END_CHAR.
  */
@@ -188,8 +210,9 @@ typedef struct BT_t {
     uint8_t type: 1;
     uint8_t connectable: 1;
     uint8_t discoverable: 1;
-    uint8_t avrcpUpdates: 2;
-    uint8_t metadataStatus: 1;
+    uint8_t avrcpUpdates: 3;
+    uint8_t metadataChanged: 3;
+    uint8_t metadataReceived: 3;
     uint8_t playbackStatus: 1;
     uint8_t vrStatus: 1;
     uint8_t callStatus: 3;
@@ -197,7 +220,13 @@ typedef struct BT_t {
     uint8_t powerState: 2;
     uint8_t pairedDevicesCount: 4;
     uint8_t pairingErrors[BT_PROFILE_COUNT];
+    uint16_t avrcpNotifications;
+    uint16_t avrcpNotificationsArmed;
     uint32_t metadataTimestamp;
+    uint32_t metadataSettleTimestamp;
+    uint32_t metadataTrackChangeTimestamp;
+    uint16_t metadataLatencyLast;
+    uint16_t metadataLatencyMax;
     uint32_t rxQueueAge;
     char title[BT_METADATA_FIELD_SIZE];
     char artist[BT_METADATA_FIELD_SIZE];
@@ -212,6 +241,10 @@ void BTClearActiveDevice(BT_t *);
 void BTClearMetadata(BT_t *);
 void BTClearPairedDevices(BT_t *, uint8_t);
 BTConnection_t BTConnectionInit();
+void BTMetadataProcess(BT_t *);
+void BTMetadataSetField(BT_t *, uint8_t, const char *);
+void BTMetadataSetFieldLength(BT_t *, uint8_t, const char *, uint16_t);
+void BTMetadataSetNormalizedField(BT_t *, uint8_t, const char *);
 void BTPairedDeviceInit(BT_t *, uint8_t *, char *, uint8_t);
 char *BTPairedDeviceGetName(BT_t *, uint8_t *);
 #endif /* BT_COMMON_H */
\ No newline at end of file
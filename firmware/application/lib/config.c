@@ -8,6 +8,154 @@
 
 uint8_t CONFIG_SETTING_CACHE[CONFIG_SETTING_CACHE_SIZE] = {0};
 uint8_t CONFIG_VALUE_CACHE[CONFIG_VALUE_CACHE_SIZE] = {0};
+// Both caches are tracked as one range of slots, settings first. A cached
+// value of zero is a legitimate value, so validity is tracked separately.
+static uint8_t CONFIG_CACHE_VALID[CONFIG_CACHE_BITMAP_SIZE] = {0};
+// Slots that were written but not yet committed to the EEPROM
+static uint8_t CONFIG_CACHE_DIRTY[CONFIG_CACHE_BITMAP_SIZE] = {0};
+static uint8_t ConfigDirtyCount = 0;
+static uint32_t ConfigLastWriteTimestamp = 0;
+// Frequently changing values that live in the record store instead of at
+// their fixed addresses. Each range is written as a single record.
+static const ConfigStoreRange_t CONFIG_STORE_RANGES[] = {
+    {STORE_KEY_TRAPS, CONFIG_TRAP_OSC, CONFIG_TRAP_LAST_ERR - CONFIG_TRAP_OSC + 1},
+    {
+        STORE_KEY_BC127_BOOT_FAILURES,
+        CONFIG_INFO_BC127_BOOT_FAIL_COUNTER_MSB_ADDRESS,
+        2
+    },
+    {
+        STORE_KEY_LAST_CONNECTED_DEVICE,
+        CONFIG_SETTING_LAST_CONNECTED_DEVICE_ADDRESS,
+        CONFIG_SETTING_LAST_CONNECTED_DEVICE_MAC_ADDRESS + 6 -
+            CONFIG_SETTING_LAST_CONNECTED_DEVICE_ADDRESS
+    }
+};
+
+/**
+ * ConfigBitmapTest()
+ *     Description:
+ *         Check if the bit for the given slot is set
+ *     Params:
+ *         uint8_t *bitmap - The bitmap
+ *         uint8_t slot - The cache slot
+ *     Returns:
+ *         uint8_t - 1 if the bit is set, 0 otherwise
+ */
+static inline uint8_t ConfigBitmapTest(uint8_t *bitmap, uint8_t slot)
+{
+    return (bitmap[slot >> 3] >> (slot & 0x07)) & 1;
+}
+
+/**
+ * ConfigBitmapSet()
+ *     Description:
+ *         Set the bit for the given slot
+ *     Params:
+ *         uint8_t *bitmap - The bitmap
+ *         uint8_t slot - The cache slot
+ *     Returns:
+ *         void
+ */
+static inline void ConfigBitmapSet(uint8_t *bitmap, uint8_t slot)
+{
+    bitmap[slot >> 3] |= 1 << (slot & 0x07);
+}
+
+/**
+ * ConfigBitmapClear()
+ *     Description:
+ *         Clear the bit for the given slot
+ *     Params:
+ *         uint8_t *bitmap - The bitmap
+ *         uint8_t slot - The cache slot
+ *     Returns:
+ *         void
+ */
+static inline void ConfigBitmapClear(uint8_t *bitmap, uint8_t slot)
+{
+    bitmap[slot >> 3] &= ~(1 << (slot & 0x07));
+}
+
+/**
+ * ConfigCacheGetSlot()
+ *     Description:
+ *         Get the cache slot for the given address
+ *     Params:
+ *         uint8_t address - The EEPROM address
+ *     Returns:
+ *         uint8_t - The slot, or CONFIG_CACHE_SLOT_NONE if it is not cached
+ */
+static inline uint8_t ConfigCacheGetSlot(uint8_t address)
+{
+    if (address < CONFIG_SETTING_CACHE_SIZE) {
+        return address;
+    }
+    if (address >= CONFIG_VALUE_START_ADDRESS &&
+        address <= CONFIG_VALUE_END_ADDRESS
+    ) {
+        return CONFIG_SETTING_CACHE_SIZE + address - CONFIG_VALUE_START_ADDRESS;
+    }
+    return CONFIG_CACHE_SLOT_NONE;
+}
+
+/**
+ * ConfigCacheGetAddress()
+ *     Description:
+ *         Get the EEPROM address of the given cache slot
+ *     Params:
+ *         uint8_t slot - The cache slot
+ *     Returns:
+ *         uint8_t - The EEPROM address
+ */
+static inline uint8_t ConfigCacheGetAddress(uint8_t slot)
+{
+    if (slot < CONFIG_SETTING_CACHE_SIZE) {
+        return slot;
+    }
+    return slot - CONFIG_SETTING_CACHE_SIZE + CONFIG_VALUE_START_ADDRESS;
+}
+
+/**
+ * ConfigCacheGetData()
+ *     Description:
+ *         Get the cached data for the given slot
+ *     Params:
+ *         uint8_t slot - The cache slot
+ *     Returns:
+ *         uint8_t * - The cached byte
+ */
+static inline uint8_t *ConfigCacheGetData(uint8_t slot)
+{
+    if (slot < CONFIG_SETTING_CACHE_SIZE) {
+        return &CONFIG_SETTING_CACHE[slot];
+    }
+    return &CONFIG_VALUE_CACHE[slot - CONFIG_SETTING_CACHE_SIZE];
+}
+
+/**
+ * ConfigStoreGetRange()
+ *     Description:
+ *         Get the record store range that the given address belongs to
+ *     Params:
+ *         uint8_t address - The EEPROM address
+ *     Returns:
+ *         uint8_t - The index of the range, CONFIG_STORE_RANGE_NONE if the
+ *             address is kept at its fixed address
+ */
+static uint8_t ConfigStoreGetRange(uint8_t address)
+{
+    uint8_t idx = 0;
+    for (idx = 0; idx < CONFIG_STORE_RANGE_COUNT; idx++) {
+        const ConfigStoreRange_t *range = &CONFIG_STORE_RANGES[idx];
+        if (address >= range->address &&
+            address < range->address + range->size
+        ) {
+            return idx;
+        }
+    }
+    return CONFIG_STORE_RANGE_NONE;
+}
 
 /**
  * ConfigGetByte()
@@ -20,36 +168,227 @@ uint8_t CONFIG_VALUE_CACHE[CONFIG_VALUE_CACHE_SIZE] = {0};
  */
 static inline uint8_t ConfigGetByte(uint8_t address)
 {
-    uint8_t value = 0;
-    if (address < CONFIG_SETTING_CACHE_SIZE) {
-        value = CONFIG_SETTING_CACHE[address];
-    }
-    if (value == 0x00) {
+    uint8_t slot = ConfigCacheGetSlot(address);
+    uint8_t value = 0x00;
+    // The cache may hold writes that are not in the EEPROM yet
+    if (slot != CONFIG_CACHE_SLOT_NONE &&
+        ConfigBitmapTest(CONFIG_CACHE_VALID, slot) == 1
+    ) {
+        value = *ConfigCacheGetData(slot);
+    } else {
         value = EEPROMReadByte(address);
-        if (value == 0xFF) {
-            value = 0x00;
-        }
+        // Only the setting cache holds values as returned from here
         if (address < CONFIG_SETTING_CACHE_SIZE) {
-            CONFIG_SETTING_CACHE[address] = value;
+            CONFIG_SETTING_CACHE[address] = value == 0xFF ? 0x00 : value;
+            ConfigBitmapSet(CONFIG_CACHE_VALID, address);
         }
     }
+    if (value == 0xFF) {
+        value = 0x00;
+    }
     return value;
 }
 
+/**
+ * ConfigSetRange()
+ *     Description:
+ *         Write consecutive bytes into the cache and mark them dirty. The
+ *         EEPROM is updated later by ConfigProcess() or ConfigFlush(), so
+ *         that successive writes are coalesced into page writes. Bytes that
+ *         already hold the given value are not written again.
+ *     Params:
+ *         uint8_t address - The start address
+ *         const uint8_t *data - The bytes to write
+ *         uint8_t size - The number of bytes to write
+ *     Returns:
+ *         void
+ */
+static void ConfigSetRange(uint8_t address, const uint8_t *data, uint8_t size)
+{
+    uint8_t storeRanges = 0;
+    uint8_t i = 0;
+    for (i = 0; i < size; i++) {
+        uint8_t slot = ConfigCacheGetSlot(address + i);
+        if (slot == CONFIG_CACHE_SLOT_NONE) {
+            // Not cached, so write it through
+            EEPROMWriteByte(address + i, data[i]);
+            continue;
+        }
+        uint8_t *cached = ConfigCacheGetData(slot);
+        if (ConfigBitmapTest(CONFIG_CACHE_VALID, slot) == 1 &&
+            *cached == data[i]
+        ) {
+            continue;
+        }
+        *cached = data[i];
+        ConfigBitmapSet(CONFIG_CACHE_VALID, slot);
+        uint8_t range = ConfigStoreGetRange(address + i);
+        if (range != CONFIG_STORE_RANGE_NONE) {
+            storeRanges |= 1 << range;
+            continue;
+        }
+        if (ConfigBitmapTest(CONFIG_CACHE_DIRTY, slot) == 0) {
+            ConfigBitmapSet(CONFIG_CACHE_DIRTY, slot);
+            ConfigDirtyCount++;
+        }
+        ConfigLastWriteTimestamp = TimerGetMillis();
+    }
+    // Append the whole range, since a record replaces the previous one
+    for (i = 0; i < CONFIG_STORE_RANGE_COUNT; i++) {
+        if ((storeRanges & (1 << i)) != 0) {
+            const ConfigStoreRange_t *range = &CONFIG_STORE_RANGES[i];
+            StoreSet(
+                range->key,
+                ConfigCacheGetData(ConfigCacheGetSlot(range->address)),
+                range->size
+            );
+        }
+    }
+}
+
 /**
  * ConfigSetByte()
  *     Description:
- *         Set a byte into the EEPROM and update cache
+ *         Set a byte into the cache, to be committed to the EEPROM later
  *     Params:
  *         uint8_t address - The address to read from
  *         uint8_t value - Value to set
  */
 static inline void ConfigSetByte(uint8_t address, uint8_t value)
 {
-    if (address < CONFIG_SETTING_CACHE_SIZE) {
-        CONFIG_SETTING_CACHE[address] = value;
+    ConfigSetRange(address, &value, 1);
+}
+
+/**
+ * ConfigFlushRun()
+ *     Description:
+ *         Commit the first run of consecutive dirty bytes to the EEPROM with
+ *         a single page write
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if anything was written, 0 if nothing was dirty
+ */
+static uint8_t ConfigFlushRun()
+{
+    uint8_t slot = 0;
+    while (slot < CONFIG_CACHE_SLOTS &&
+           ConfigBitmapTest(CONFIG_CACHE_DIRTY, slot) == 0
+    ) {
+        // Skip over clean bitmap bytes at once
+        if ((slot & 0x07) == 0 && CONFIG_CACHE_DIRTY[slot >> 3] == 0) {
+            slot += 8;
+        } else {
+            slot++;
+        }
+    }
+    if (slot >= CONFIG_CACHE_SLOTS) {
+        ConfigDirtyCount = 0;
+        return 0;
+    }
+    uint8_t first = slot;
+    uint8_t address = ConfigCacheGetAddress(first);
+    uint8_t page = address / CONFIG_FLUSH_PAGE_SIZE;
+    uint8_t size = 0;
+    // Slots are only contiguous in memory within one of the caches
+    uint8_t limit = CONFIG_CACHE_SLOTS;
+    if (first < CONFIG_SETTING_CACHE_SIZE) {
+        limit = CONFIG_SETTING_CACHE_SIZE;
+    }
+    while (slot < limit &&
+           ConfigBitmapTest(CONFIG_CACHE_DIRTY, slot) == 1 &&
+           ConfigCacheGetAddress(slot) / CONFIG_FLUSH_PAGE_SIZE == page
+    ) {
+        ConfigBitmapClear(CONFIG_CACHE_DIRTY, slot);
+        ConfigDirtyCount--;
+        size++;
+        slot++;
+    }
+    EEPROMWriteBytes(address, ConfigCacheGetData(first), size);
+    return 1;
+}
+
+/**
+ * ConfigInit()
+ *     Description:
+ *         Load the setting and value caches with one sequential read each, so
+ *         that reading the configuration does not go to the EEPROM after boot
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void ConfigInit()
+{
+    uint8_t idx = 0;
+    EEPROMReadBytes(0x00, CONFIG_SETTING_CACHE, CONFIG_SETTING_CACHE_SIZE);
+    for (idx = 0; idx < CONFIG_SETTING_CACHE_SIZE; idx++) {
+        // Match ConfigGetByte(), which treats erased bytes as 0x00
+        if (CONFIG_SETTING_CACHE[idx] == 0xFF) {
+            CONFIG_SETTING_CACHE[idx] = 0x00;
+        }
+    }
+    EEPROMReadBytes(
+        CONFIG_VALUE_START_ADDRESS,
+        CONFIG_VALUE_CACHE,
+        CONFIG_VALUE_CACHE_SIZE
+    );
+    memset(CONFIG_CACHE_VALID, 0xFF, sizeof(CONFIG_CACHE_VALID));
+    uint8_t isFormatted = StoreInit() == 0;
+    for (idx = 0; idx < CONFIG_STORE_RANGE_COUNT; idx++) {
+        const ConfigStoreRange_t *range = &CONFIG_STORE_RANGES[idx];
+        uint8_t *data = ConfigCacheGetData(ConfigCacheGetSlot(range->address));
+        if (isFormatted == 1) {
+            // Carry the values over from their fixed addresses
+            StoreSet(range->key, data, range->size);
+        } else {
+            StoreGet(range->key, data, range->size);
+        }
+    }
+}
+
+/**
+ * ConfigFlush()
+ *     Description:
+ *         Commit every pending write to the EEPROM, blocking until it is
+ *         done. This must be called before resetting the device.
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void ConfigFlush()
+{
+    while (ConfigFlushRun() == 1);
+    EEPROMFlush();
+}
+
+/**
+ * ConfigProcess()
+ *     Description:
+ *         Commit one page of pending writes once the configuration has not
+ *         been written to for CONFIG_FLUSH_DELAY, so that bursts of writes
+ *         are coalesced. A page is only queued once the EEPROM has no other
+ *         writes waiting.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if a page was written, 0 otherwise
+ */
+uint8_t ConfigProcess()
+{
+    if (StoreProcess() == 1) {
+        return 1;
+    }
+    if (ConfigDirtyCount == 0) {
+        return 0;
     }
-    EEPROMWriteByte(address, value);
+    if ((TimerGetMillis() - ConfigLastWriteTimestamp) < CONFIG_FLUSH_DELAY ||
+        EEPROMGetWriteQueueDepth() > 0
+    ) {
+        return 0;
+    }
+    return ConfigFlushRun();
 }
 
 /**
@@ -358,6 +697,45 @@ uint8_t ConfigGetSetting(uint8_t setting)
     return value;
 }
 
+/**
+ * ConfigGetSnapshot()
+ *     Description:
+ *         Build a snapshot of the user configuration, framed with the
+ *         snapshot version, its address range and an XOR checksum. The
+ *         last connected device is zeroed, so it does not leave the unit.
+ *     Params:
+ *         uint8_t *snapshot - The buffer, at least CONFIG_SNAPSHOT_SIZE bytes
+ *     Returns:
+ *         uint8_t - The size of the snapshot
+ */
+uint8_t ConfigGetSnapshot(uint8_t *snapshot)
+{
+    uint8_t checksum = 0x00;
+    uint8_t idx = 0;
+    snapshot[0] = CONFIG_SNAPSHOT_VERSION;
+    snapshot[1] = CONFIG_SNAPSHOT_START_ADDRESS;
+    snapshot[2] = CONFIG_SNAPSHOT_LENGTH;
+    ConfigGetBytes(
+        CONFIG_SNAPSHOT_START_ADDRESS,
+        &snapshot[CONFIG_SNAPSHOT_HEADER_SIZE],
+        CONFIG_SNAPSHOT_LENGTH
+    );
+    memset(
+        &snapshot[
+            CONFIG_SNAPSHOT_HEADER_SIZE +
+            CONFIG_SNAPSHOT_EXCLUDE_START -
+            CONFIG_SNAPSHOT_START_ADDRESS
+        ],
+        0x00,
+        CONFIG_SNAPSHOT_EXCLUDE_END - CONFIG_SNAPSHOT_EXCLUDE_START + 1
+    );
+    for (idx = 0; idx < CONFIG_SNAPSHOT_SIZE - 1; idx++) {
+        checksum ^= snapshot[idx];
+    }
+    snapshot[CONFIG_SNAPSHOT_SIZE - 1] = checksum;
+    return CONFIG_SNAPSHOT_SIZE;
+}
+
 /**
  * ConfigGetString()
  *     Description:
@@ -509,10 +887,13 @@ uint8_t ConfigGetValue(uint8_t value)
     if (value >= CONFIG_VALUE_START_ADDRESS &&
         value <= CONFIG_VALUE_END_ADDRESS
     ) {
-        data = CONFIG_VALUE_CACHE[value - CONFIG_VALUE_START_ADDRESS];
-        if (data == 0x00) {
+        uint8_t slot = ConfigCacheGetSlot(value);
+        if (ConfigBitmapTest(CONFIG_CACHE_VALID, slot) == 1) {
+            data = *ConfigCacheGetData(slot);
+        } else {
             data = EEPROMReadByte(value);
-            CONFIG_VALUE_CACHE[value - CONFIG_VALUE_START_ADDRESS] = data;
+            *ConfigCacheGetData(slot) = data;
+            ConfigBitmapSet(CONFIG_CACHE_VALID, slot);
         }
     }
     return data;
@@ -547,8 +928,9 @@ void ConfigGetVehicleIdentity(uint8_t *vin)
  */
 void ConfigSetBC127BootFailures(uint16_t failureCount)
 {
-    ConfigSetValue(CONFIG_INFO_BC127_BOOT_FAIL_COUNTER_MSB, failureCount >> 8);
-    ConfigSetValue(CONFIG_INFO_BC127_BOOT_FAIL_COUNTER_LSB, failureCount & 0xFF);
+    uint8_t data[] = {failureCount >> 8, failureCount & 0xFF};
+    // Both bytes are kept in a single store record
+    ConfigSetRange(CONFIG_INFO_BC127_BOOT_FAIL_COUNTER_MSB, data, sizeof(data));
 }
 
 /**
@@ -576,11 +958,7 @@ void ConfigSetBootloaderMode(uint8_t bootloaderMode)
  */
 void ConfigSetBytes(uint8_t address, const uint8_t *data, uint8_t size)
 {
-    uint8_t i = 0;
-    for (i = 0; i < size; i++) {
-        ConfigSetByte(address, data[i]);
-        address++;
-    }
+    ConfigSetRange(address, data, size);
 }
 
 /**
@@ -753,6 +1131,94 @@ void ConfigSetSetting(uint8_t setting, uint8_t value)
     }
 }
 
+/**
+ * ConfigSetSettings()
+ *     Description:
+ *         Set every setting in the given range to the same value
+ *     Params:
+ *         uint8_t start - The first setting to set
+ *         uint8_t end - The last setting to set
+ *         uint8_t value - The value to set
+ *     Returns:
+ *         void
+ */
+void ConfigSetSettings(uint8_t start, uint8_t end, uint8_t value)
+{
+    // Catch invalid setting addresses
+    if (start < CONFIG_SETTING_START_ADDRESS ||
+        end > CONFIG_SETTING_END_ADDRESS ||
+        start > end
+    ) {
+        return;
+    }
+    uint8_t size = end - start + 1;
+    uint8_t data[size];
+    memset(data, value, size);
+    ConfigSetRange(start, data, size);
+}
+
+/**
+ * ConfigSetSnapshot()
+ *     Description:
+ *         Validate a snapshot built by ConfigGetSnapshot() and apply it in a
+ *         single transaction, so that it is committed with page writes. The
+ *         bytes that overlap the last connected device are skipped.
+ *     Params:
+ *         const uint8_t *snapshot - The snapshot
+ *         uint8_t size - The size of the snapshot
+ *     Returns:
+ *         uint8_t - CONFIG_SNAPSHOT_OK or the reason it was rejected
+ */
+uint8_t ConfigSetSnapshot(const uint8_t *snapshot, uint8_t size)
+{
+    uint8_t checksum = 0x00;
+    uint8_t idx = 0;
+    if (size < CONFIG_SNAPSHOT_HEADER_SIZE + 1 ||
+        size != CONFIG_SNAPSHOT_HEADER_SIZE + snapshot[2] + 1
+    ) {
+        return CONFIG_SNAPSHOT_ERROR_SIZE;
+    }
+    for (idx = 0; idx < size; idx++) {
+        checksum ^= snapshot[idx];
+    }
+    if (checksum != 0x00) {
+        return CONFIG_SNAPSHOT_ERROR_CHECKSUM;
+    }
+    if (snapshot[0] != CONFIG_SNAPSHOT_VERSION) {
+        return CONFIG_SNAPSHOT_ERROR_VERSION;
+    }
+    uint8_t start = snapshot[1];
+    uint8_t length = snapshot[2];
+    uint16_t end = start + length - 1;
+    const uint8_t *data = &snapshot[CONFIG_SNAPSHOT_HEADER_SIZE];
+    // Only the user configuration may be written, never the vehicle or
+    // device data
+    if (start < CONFIG_SNAPSHOT_START_ADDRESS ||
+        length == 0 ||
+        end > CONFIG_SETTING_END_ADDRESS ||
+        (start >= CONFIG_SNAPSHOT_EXCLUDE_START &&
+         end <= CONFIG_SNAPSHOT_EXCLUDE_END)
+    ) {
+        return CONFIG_SNAPSHOT_ERROR_RANGE;
+    }
+    if (start < CONFIG_SNAPSHOT_EXCLUDE_START) {
+        uint8_t count = length;
+        if (end >= CONFIG_SNAPSHOT_EXCLUDE_START) {
+            count = CONFIG_SNAPSHOT_EXCLUDE_START - start;
+        }
+        ConfigSetRange(start, data, count);
+    }
+    if (end > CONFIG_SNAPSHOT_EXCLUDE_END) {
+        uint8_t from = start;
+        if (from <= CONFIG_SNAPSHOT_EXCLUDE_END) {
+            from = CONFIG_SNAPSHOT_EXCLUDE_END + 1;
+        }
+        ConfigSetRange(from, &data[from - start], end - from + 1);
+    }
+    ConfigFlush();
+    return CONFIG_SNAPSHOT_OK;
+}
+
 /**
  * ConfigSetString()
  *     Description:
@@ -766,12 +1232,11 @@ void ConfigSetSetting(uint8_t setting, uint8_t value)
  */
 void ConfigSetString(uint8_t address, char *string, uint8_t size)
 {
-    uint8_t i = 0;
-    for (i = 0; i < size; i++) {
-        ConfigSetByte(address, string[i]);
-        address++;
-    }
-    ConfigSetByte(address, 0);
+    // Write the terminator separately, since size + 1 does not fit a uint8_t
+    // when size is 255
+    uint8_t terminator = 0;
+    ConfigSetRange(address, (uint8_t *) string, size);
+    ConfigSetRange(address + size, &terminator, 1);
 }
 
 /**
@@ -924,8 +1389,6 @@ void ConfigSetVehicleType(uint8_t vehicleType)
 void ConfigSetVehicleIdentity(uint8_t *vin)
 {
     uint8_t vinAddress[] = CONFIG_VEHICLE_VIN_ADDRESS;
-    uint8_t i;
-    for (i = 0; i < 5; i++) {
-        ConfigSetByte(vinAddress[i], vin[i]);
-    }
+    // The VIN bytes are stored consecutively
+    ConfigSetRange(vinAddress[0], vin, sizeof(vinAddress));
 }
@@ -7,6 +7,8 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 #include "eeprom.h"
+#include "store.h"
+#include "timer.h"
 
 /* EEPROM 0x00 - 0x07: Reserved for the BlueBus */
 #define CONFIG_SN_ADDRESS_MSB 0x00
@@ -80,6 +82,10 @@
 #define CONFIG_DEVICE_LOG_IBUS 3
 #define CONFIG_DEVICE_LOG_SYSTEM 4
 #define CONFIG_DEVICE_LOG_UI 5
+// Not a source: log with microsecond rather than millisecond timestamps
+#define CONFIG_DEVICE_LOG_TIMESTAMP_US 6
+// Not a source: send log messages as binary frames, see log.h
+#define CONFIG_DEVICE_LOG_BINARY 7
 
 #define CONFIG_UI_CD53 1
 #define CONFIG_UI_BMBT 2
@@ -171,9 +177,55 @@
 #define CONFIG_VALUE_START_ADDRESS 0xA0
 #define CONFIG_VALUE_END_ADDRESS 0xB0
 
-#define CONFIG_SETTING_CACHE_SIZE CONFIG_SETTING_END_ADDRESS
+#define CONFIG_SETTING_CACHE_SIZE (CONFIG_SETTING_END_ADDRESS + 1)
 #define CONFIG_VALUE_CACHE_SIZE (CONFIG_VALUE_END_ADDRESS - CONFIG_VALUE_START_ADDRESS + 1)
+#define CONFIG_CACHE_SLOTS (CONFIG_SETTING_CACHE_SIZE + CONFIG_VALUE_CACHE_SIZE)
+#define CONFIG_CACHE_SLOT_NONE 0xFF
+// One bit per cache slot, for the valid and dirty bitmaps
+#define CONFIG_CACHE_BITMAP_SIZE ((CONFIG_CACHE_SLOTS + 7) / 8)
+// Wait for writes to settle for this long (ms) before committing them
+#define CONFIG_FLUSH_DELAY 500
+// Write in pages that are aligned for both EEPROM variants
+#define CONFIG_FLUSH_PAGE_SIZE EEPROM_PAGE_SIZE_HW2
+// Snapshots cover the user configuration, excluding the device data. They
+// start after the vehicle data (0x0F - 0x19), so that loading a snapshot into
+// another car does not copy the VIN and vehicle detection along with it.
+#define CONFIG_SNAPSHOT_VERSION 0x01
+#define CONFIG_SNAPSHOT_START_ADDRESS 0x1A
+#define CONFIG_SNAPSHOT_LENGTH (CONFIG_SETTING_END_ADDRESS - CONFIG_SNAPSHOT_START_ADDRESS + 1)
+// The last connected device and its MAC ID are device data within the range.
+// They are zeroed in snapshots and never written when loading one.
+#define CONFIG_SNAPSHOT_EXCLUDE_START CONFIG_SETTING_LAST_CONNECTED_DEVICE_ADDRESS
+#define CONFIG_SNAPSHOT_EXCLUDE_END 0x6A
+// Version, start address and length, followed by the data and checksum
+#define CONFIG_SNAPSHOT_HEADER_SIZE 3
+#define CONFIG_SNAPSHOT_SIZE (CONFIG_SNAPSHOT_HEADER_SIZE + CONFIG_SNAPSHOT_LENGTH + 1)
+#define CONFIG_SNAPSHOT_OK 0
+#define CONFIG_SNAPSHOT_ERROR_SIZE 1
+#define CONFIG_SNAPSHOT_ERROR_CHECKSUM 2
+#define CONFIG_SNAPSHOT_ERROR_VERSION 3
+#define CONFIG_SNAPSHOT_ERROR_RANGE 4
+#define CONFIG_STORE_RANGE_COUNT 3
+#define CONFIG_STORE_RANGE_NONE 0xFF
 
+/**
+ * ConfigStoreRange_t
+ *     Description:
+ *         A range of configuration addresses that is kept in the record store
+ *     Fields:
+ *         key - The record store key
+ *         address - The first address of the range
+ *         size - The number of bytes in the range
+ */
+typedef struct ConfigStoreRange_t {
+    uint8_t key;
+    uint8_t address;
+    uint8_t size;
+} ConfigStoreRange_t;
+
+void ConfigInit();
+void ConfigFlush();
+uint8_t ConfigProcess();
 uint16_t ConfigGetBC127BootFailures();
 uint8_t ConfigGetBuildWeek();
 uint8_t ConfigGetBuildYear();
@@ -191,6 +243,7 @@ uint8_t ConfigGetLog(uint8_t);
 uint8_t ConfigGetNavType();
 uint16_t ConfigGetSerialNumber();
 uint8_t ConfigGetSetting(uint8_t);
+uint8_t ConfigGetSnapshot(uint8_t *);
 uint8_t ConfigGetTelephonyFeaturesActive();
 uint8_t ConfigGetTempDisplay();
 uint8_t ConfigGetTempUnit();
@@ -212,6 +265,8 @@ void ConfigSetIKEType(uint8_t);
 void ConfigSetLMVariant(uint8_t);
 void ConfigSetLog(uint8_t, uint8_t);
 void ConfigSetSetting(uint8_t, uint8_t);
+void ConfigSetSettings(uint8_t, uint8_t, uint8_t);
+uint8_t ConfigSetSnapshot(const uint8_t *, uint8_t);
 void ConfigSetString(uint8_t, char *, uint8_t);
 void ConfigSetNavType(uint8_t);
 void ConfigSetTempDisplay(uint8_t);
@@ -12,6 +12,22 @@ static const uint8_t SPI_SDO_MODES[] = {7, 10, 23};
 // These values constitute the SCK mode for each SPI module
 static const uint8_t SPI_SCK_MODES[] = {8, 11, 24};
 
+static uint32_t EEPROMReadCount = 0;
+static uint32_t EEPROMReadRateTimestamp = 0;
+static uint16_t EEPROMReadRateCount = 0;
+static uint16_t EEPROMReadRate = 0;
+// Writes are queued and started one at a time, so that callers do not wait
+// for the write cycle of the EEPROM
+static EEPROMWrite_t EEPROMWriteQueue[EEPROM_WRITE_QUEUE_SIZE];
+static uint8_t EEPROMWriteQueueHead = 0;
+static uint8_t EEPROMWriteQueueTail = 0;
+static uint8_t EEPROMWriteQueueDepth = 0;
+static uint8_t EEPROMWriteQueuePeak = 0;
+// A write may still be in progress from before a reset
+static uint8_t EEPROMWriteInProgress = 1;
+static uint32_t EEPROMStallCount = 0;
+static uint32_t EEPROMStallTime = 0;
+
 /**
  * EEPROMInit()
  *     Description:
@@ -64,6 +80,190 @@ static unsigned char EEPROMSend(char data)
     return SPI1BUFL;
 }
 
+/**
+ * EEPROMSendAddress()
+ *     Description:
+ *         Send the given memory address to the EEPROM
+ *     Params:
+ *         uint32_t address - The memory address
+ *     Returns:
+ *         void
+ */
+static void EEPROMSendAddress(uint32_t address)
+{
+    // The HW1 boards use a 1024kB EEPROM while the HW2 boards use a
+    // 128kB EEPROM. This means that we need not send as many address bytes
+    if (UtilsGetBoardVersion() == BOARD_VERSION_ONE) {
+        EEPROMSend(address >> 16 & 0xFF);
+    }
+    EEPROMSend(address >> 8 & 0xFF);
+    EEPROMSend(address & 0xFF);
+}
+
+/**
+ * EEPROMGetPageSize()
+ *     Description:
+ *         Get the page size of the EEPROM on this board
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint16_t - The page size
+ */
+static uint16_t EEPROMGetPageSize()
+{
+    if (UtilsGetBoardVersion() == BOARD_VERSION_ONE) {
+        return EEPROM_PAGE_SIZE_HW1;
+    }
+    return EEPROM_PAGE_SIZE_HW2;
+}
+
+/**
+ * EEPROMIsBusy()
+ *     Description:
+ *         Check once if the last write is still in progress. The status
+ *         register is only read while a write is known to be in flight.
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint8_t - 1 if the EEPROM is busy, 0 otherwise
+ */
+static uint8_t EEPROMIsBusy()
+{
+    if (EEPROMWriteInProgress == 0) {
+        return 0;
+    }
+    EEPROM_CS_PIN = 0;
+    EEPROMSend(EEPROM_COMMAND_RDSR);
+    uint8_t status = EEPROMSend(EEPROM_COMMAND_GET);
+    EEPROM_CS_PIN = 1;
+    if ((status & EEPROM_STATUS_BUSY) == 0) {
+        EEPROMWriteInProgress = 0;
+    }
+    return EEPROMWriteInProgress;
+}
+
+/**
+ * EEPROMStartWrite()
+ *     Description:
+ *         Send a write to the EEPROM without waiting for its write cycle
+ *     Params:
+ *         EEPROMWrite_t *write - The write to start
+ *     Returns:
+ *         void
+ */
+static void EEPROMStartWrite(EEPROMWrite_t *write)
+{
+    EEPROM_CS_PIN = 0;
+    EEPROMSend(EEPROM_COMMAND_WREN);
+    EEPROM_CS_PIN = 1;
+    EEPROM_CS_PIN = 0;
+    EEPROMSend(EEPROM_COMMAND_WRITE);
+    EEPROMSendAddress(write->address);
+    uint8_t idx = 0;
+    for (idx = 0; idx < write->length; idx++) {
+        EEPROMSend(write->data[idx]);
+    }
+    EEPROM_CS_PIN = 1;
+    EEPROMWriteInProgress = 1;
+}
+
+/**
+ * EEPROMQueueWrite()
+ *     Description:
+ *         Queue a write that does not cross a page boundary and start it if
+ *         the EEPROM is idle. A write that continues the last queued one on
+ *         the same page is merged into it. If the queue is full, this
+ *         blocks until a queued write has been started.
+ *     Params:
+ *         uint32_t address - The memory address of the first byte
+ *         const uint8_t *data - The bytes to write
+ *         uint8_t length - The number of bytes, up to EEPROM_WRITE_SIZE
+ *     Returns:
+ *         void
+ */
+static void EEPROMQueueWrite(uint32_t address, const uint8_t *data, uint8_t length)
+{
+    if (EEPROMWriteQueueDepth > 0) {
+        EEPROMWrite_t *last = &EEPROMWriteQueue[
+            (EEPROMWriteQueueTail + EEPROM_WRITE_QUEUE_SIZE - 1) %
+            EEPROM_WRITE_QUEUE_SIZE
+        ];
+        uint16_t pageSize = EEPROMGetPageSize();
+        if (last->address + last->length == address &&
+            last->length + length <= EEPROM_WRITE_SIZE &&
+            last->address / pageSize == (address + length - 1) / pageSize
+        ) {
+            memcpy(&last->data[last->length], data, length);
+            last->length += length;
+            return;
+        }
+    }
+    while (EEPROMWriteQueueDepth == EEPROM_WRITE_QUEUE_SIZE) {
+        EEPROMIsReady();
+        EEPROMProcess();
+    }
+    EEPROMWrite_t *write = &EEPROMWriteQueue[EEPROMWriteQueueTail];
+    write->address = address;
+    write->length = length;
+    memcpy(write->data, data, length);
+    EEPROMWriteQueueTail = (EEPROMWriteQueueTail + 1) % EEPROM_WRITE_QUEUE_SIZE;
+    EEPROMWriteQueueDepth++;
+    if (EEPROMWriteQueueDepth > EEPROMWriteQueuePeak) {
+        EEPROMWriteQueuePeak = EEPROMWriteQueueDepth;
+    }
+    EEPROMProcess();
+}
+
+/**
+ * EEPROMPrepareRead()
+ *     Description:
+ *         Make sure that a read returns the latest data. Queued writes are
+ *         only committed if they overlap the range being read, otherwise
+ *         this only waits for a write that is in flight.
+ *     Params:
+ *         uint32_t address - The memory address of the first byte
+ *         uint16_t length - The number of bytes to read
+ *     Returns:
+ *         void
+ */
+static void EEPROMPrepareRead(uint32_t address, uint16_t length)
+{
+    uint8_t count = 0;
+    uint8_t idx = EEPROMWriteQueueHead;
+    for (count = 0; count < EEPROMWriteQueueDepth; count++) {
+        EEPROMWrite_t *write = &EEPROMWriteQueue[idx];
+        if (write->address < address + length &&
+            address < write->address + write->length
+        ) {
+            EEPROMFlush();
+            return;
+        }
+        idx = (idx + 1) % EEPROM_WRITE_QUEUE_SIZE;
+    }
+    EEPROMIsReady();
+}
+
+/**
+ * EEPROMCountRead()
+ *     Description:
+ *         Account for bytes read from the EEPROM in the read counters
+ *     Params:
+ *         uint16_t length - The number of bytes read
+ *     Returns:
+ *         void
+ */
+static void EEPROMCountRead(uint16_t length)
+{
+    uint32_t now = TimerGetMillis();
+    if (now - EEPROMReadRateTimestamp >= EEPROM_READ_RATE_INTERVAL) {
+        EEPROMReadRate = EEPROMReadRateCount;
+        EEPROMReadRateCount = 0;
+        EEPROMReadRateTimestamp = now;
+    }
+    EEPROMReadRateCount += length;
+    EEPROMReadCount += length;
+}
+
 /**
  * EEPROMEnableWrite()
  *     Description:
@@ -93,17 +293,39 @@ static void EEPROMEnableWrite()
  */
 void EEPROMErase()
 {
+    EEPROMFlush();
     EEPROMEnableWrite();
     EEPROM_CS_PIN = 0;
     EEPROMSend(EEPROM_COMMAND_CE);
     EEPROM_CS_PIN = 1;
+    EEPROMWriteInProgress = 1;
+}
+
+/**
+ * EEPROMFlush()
+ *     Description:
+ *         Commit all queued writes, blocking until the last one has
+ *         completed its write cycle
+ *     Params:
+ *         void
+ *     Returns:
+ *         void
+ */
+void EEPROMFlush()
+{
+    while (EEPROMWriteQueueDepth > 0) {
+        EEPROMIsReady();
+        EEPROMProcess();
+    }
+    EEPROMIsReady();
 }
 
 /**
  * EEPROMIsReady()
  *     Description:
  *         Check with the EEPROM to see if it's ready to be written to. If it
- *         is not, this function blocks until it is ready (status 0x00).
+ *         is not, this function blocks until it is ready (status 0x00) and
+ *         accounts for the wait in the stall counters.
  *     Params:
  *         void
  *     Returns:
@@ -111,13 +333,13 @@ void EEPROMErase()
  */
 void EEPROMIsReady()
 {
-    char status = EEPROM_STATUS_BUSY;
-    while (status & EEPROM_STATUS_BUSY) {
-        EEPROM_CS_PIN = 0;
-        EEPROMSend(EEPROM_COMMAND_RDSR);
-        status = EEPROMSend(EEPROM_COMMAND_GET);
-        EEPROM_CS_PIN = 1;
+    if (EEPROMIsBusy() == 0) {
+        return;
     }
+    uint32_t start = TimerGetMicroseconds();
+    while (EEPROMIsBusy() == 1);
+    EEPROMStallCount++;
+    EEPROMStallTime += TimerGetMicroseconds() - start;
 }
 
 /**
@@ -131,16 +353,11 @@ void EEPROMIsReady()
  */
 unsigned char EEPROMReadByte(uint32_t address)
 {
-    EEPROMIsReady();
+    EEPROMCountRead(1);
+    EEPROMPrepareRead(address, 1);
     EEPROM_CS_PIN = 0;
     EEPROMSend(EEPROM_COMMAND_READ);
-    // The HW1 boards use a 1024kB EEPROM while the HW2 boards use a
-    // 128kB EEPROM. This means that we need not send as many address bytes
-    if (UtilsGetBoardVersion() == BOARD_VERSION_ONE) {
-        EEPROMSend(address >> 16 & 0xFF);
-    }
-    EEPROMSend(address >> 8 & 0xFF);
-    EEPROMSend(address & 0xFF);
+    EEPROMSendAddress(address);
     // Cast return of EEPROM send to an 8-bit byte, since the returned register
     // is always 16 bits
     unsigned char data = (unsigned char)((uint8_t )EEPROMSend(EEPROM_COMMAND_GET));
@@ -148,29 +365,192 @@ unsigned char EEPROMReadByte(uint32_t address)
     return data;
 }
 
+/**
+ * EEPROMReadBytes()
+ *     Description:
+ *         Read the given number of bytes from the EEPROM, starting at the
+ *         given address, in a single sequential read
+ *     Params:
+ *         uint32_t address - The memory address of the first byte
+ *         uint8_t *data - The buffer to read into
+ *         uint16_t length - The number of bytes to read
+ *     Returns:
+ *         void
+ */
+void EEPROMReadBytes(uint32_t address, uint8_t *data, uint16_t length)
+{
+    EEPROMCountRead(length);
+    EEPROMPrepareRead(address, length);
+    EEPROM_CS_PIN = 0;
+    EEPROMSend(EEPROM_COMMAND_READ);
+    EEPROMSendAddress(address);
+    uint16_t idx = 0;
+    for (idx = 0; idx < length; idx++) {
+        data[idx] = (uint8_t) EEPROMSend(EEPROM_COMMAND_GET);
+    }
+    EEPROM_CS_PIN = 1;
+}
+
+/**
+ * EEPROMGetReadCount()
+ *     Description:
+ *         Get the number of bytes read from the EEPROM since boot
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint32_t - The number of reads
+ */
+uint32_t EEPROMGetReadCount()
+{
+    return EEPROMReadCount;
+}
+
+/**
+ * EEPROMGetStallCount()
+ *     Description:
+ *         Get the number of times that the caller had to wait for a write
+ *         cycle to complete
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint32_t - The number of stalls
+ */
+uint32_t EEPROMGetStallCount()
+{
+    return EEPROMStallCount;
+}
+
+/**
+ * EEPROMGetStallTime()
+ *     Description:
+ *         Get the total time spent waiting for write cycles to complete
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint32_t - The time in microseconds
+ */
+uint32_t EEPROMGetStallTime()
+{
+    return EEPROMStallTime;
+}
+
+/**
+ * EEPROMGetWriteQueueDepth()
+ *     Description:
+ *         Get the number of writes that are waiting to be started
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint8_t - The queue depth
+ */
+uint8_t EEPROMGetWriteQueueDepth()
+{
+    return EEPROMWriteQueueDepth;
+}
+
+/**
+ * EEPROMGetWriteQueuePeak()
+ *     Description:
+ *         Get the highest write queue depth since boot
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint8_t - The peak queue depth
+ */
+uint8_t EEPROMGetWriteQueuePeak()
+{
+    return EEPROMWriteQueuePeak;
+}
+
+/**
+ * EEPROMGetReadRate()
+ *     Description:
+ *         Get the number of bytes read from the EEPROM within the last full
+ *         EEPROM_READ_RATE_INTERVAL
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint16_t - The number of reads per interval
+ */
+uint16_t EEPROMGetReadRate()
+{
+    uint32_t elapsed = TimerGetMillis() - EEPROMReadRateTimestamp;
+    if (elapsed >= EEPROM_READ_RATE_INTERVAL * 2) {
+        // Nothing has been read for at least one full interval
+        return 0;
+    }
+    if (elapsed >= EEPROM_READ_RATE_INTERVAL) {
+        return EEPROMReadRateCount;
+    }
+    return EEPROMReadRate;
+}
+
+/**
+ * EEPROMProcess()
+ *     Description:
+ *         Start the next queued write once the previous write cycle has
+ *         completed. Called from the main loop.
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint8_t - 1 if a write was started, 0 otherwise
+ */
+uint8_t EEPROMProcess()
+{
+    if (EEPROMWriteQueueDepth == 0 || EEPROMIsBusy() == 1) {
+        return 0;
+    }
+    EEPROMStartWrite(&EEPROMWriteQueue[EEPROMWriteQueueHead]);
+    EEPROMWriteQueueHead = (EEPROMWriteQueueHead + 1) % EEPROM_WRITE_QUEUE_SIZE;
+    EEPROMWriteQueueDepth--;
+    return 1;
+}
+
 /**
  * EEPROMWriteByte()
  *     Description:
- *         Check with the EEPROM to see if it's ready to be written to. If it
- *         is not, this function blocks until it is ready (status 0x00).
+ *         Queue a byte to be written to the EEPROM
  *     Params:
- *         uint32_t address - The memory address of the byte to retrieve
+ *         uint32_t address - The memory address of the byte to write
  *         unsigned char data - The 8-bit byte to write
  *     Returns:
  *         void
  */
 void EEPROMWriteByte(uint32_t address, unsigned char data)
 {
-    EEPROMEnableWrite();
-    EEPROM_CS_PIN = 0;
-    EEPROMSend(EEPROM_COMMAND_WRITE);
-    // The HW1 boards use a 1024kB EEPROM while the HW2 boards use a
-    // 128kB EEPROM. This means that we need not send as many address bytes
-    if (UtilsGetBoardVersion() == BOARD_VERSION_ONE) {
-        EEPROMSend(address >> 16 & 0xFF);
+    uint8_t byte = data;
+    EEPROMQueueWrite(address, &byte, 1);
+}
+
+/**
+ * EEPROMWriteBytes()
+ *     Description:
+ *         Queue the given bytes to be written to the EEPROM, starting at the
+ *         given address. The data is split on page boundaries so that every
+ *         page is written in a single write cycle instead of one cycle per
+ *         byte.
+ *     Params:
+ *         uint32_t address - The memory address of the first byte
+ *         const uint8_t *data - The bytes to write
+ *         uint16_t length - The number of bytes to write
+ *     Returns:
+ *         void
+ */
+void EEPROMWriteBytes(uint32_t address, const uint8_t *data, uint16_t length)
+{
+    uint16_t pageSize = EEPROMGetPageSize();
+    while (length > 0) {
+        // Writes wrap around within a page, so stop at the page boundary
+        uint16_t chunk = pageSize - (address % pageSize);
+        if (chunk > EEPROM_WRITE_SIZE) {
+            chunk = EEPROM_WRITE_SIZE;
+        }
+        if (chunk > length) {
+            chunk = length;
+        }
+        EEPROMQueueWrite(address, data, chunk);
+        address += chunk;
+        data += chunk;
+        length -= chunk;
     }
-    EEPROMSend(address >> 8 & 0xFF);
-    EEPROMSend(address & 0xFF);
-    EEPROMSend(data);
-    EEPROM_CS_PIN = 1;
 }
@@ -22,10 +22,43 @@
 #define EEPROM_COMMAND_RDSR 0x05 // Read the status register
 #define EEPROM_COMMAND_GET 0x00 // Dummy byte used to retrieve data
 #define EEPROM_STATUS_BUSY 0x01 // EEPROM Busy status response
+// The 25LC1024 on HW1 boards has 256 byte pages, the HW2 part 64 byte pages
+#define EEPROM_PAGE_SIZE_HW1 256
+#define EEPROM_PAGE_SIZE_HW2 64
+// Window over which the read rate is measured, in milliseconds
+#define EEPROM_READ_RATE_INTERVAL 1000
+#define EEPROM_WRITE_QUEUE_SIZE 8
+// The largest write that is queued as one, aligned for both EEPROM variants
+#define EEPROM_WRITE_SIZE EEPROM_PAGE_SIZE_HW2
+
+/**
+ * EEPROMWrite_t
+ *     Description:
+ *         A queued write that lies within a single EEPROM page
+ *     Fields:
+ *         address - The memory address of the first byte
+ *         length - The number of bytes to write
+ *         data - The bytes to write
+ */
+typedef struct EEPROMWrite_t {
+    uint32_t address;
+    uint8_t length;
+    uint8_t data[EEPROM_WRITE_SIZE];
+} EEPROMWrite_t;
 
 void EEPROMInit();
 void EEPROMErase();
+void EEPROMFlush();
 void EEPROMIsReady();
 unsigned char EEPROMReadByte(uint32_t);
+void EEPROMReadBytes(uint32_t, uint8_t *, uint16_t);
+uint32_t EEPROMGetReadCount();
+uint16_t EEPROMGetReadRate();
+uint32_t EEPROMGetStallCount();
+uint32_t EEPROMGetStallTime();
+uint8_t EEPROMGetWriteQueueDepth();
+uint8_t EEPROMGetWriteQueuePeak();
+uint8_t EEPROMProcess();
 void EEPROMWriteByte(uint32_t, unsigned char);
+void EEPROMWriteBytes(uint32_t, const uint8_t *, uint16_t);
 #endif /* EEPROM_H */
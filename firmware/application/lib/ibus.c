@@ -800,19 +800,15 @@ void IBusProcess(IBus_t *ibus)
             uint8_t msgLength = ibus->rxBuffer[1] + 2;
             // Make sure we do not read more than the maximum packet length
             if (msgLength > IBUS_MAX_MSG_LENGTH) {
-                long long unsigned int ts = (long long unsigned int) TimerGetMillis();
+                long long unsigned int ts = LogGetTimestamp();
                 LogRawDebug(
                     LOG_SOURCE_IBUS,
-                    "[%llu] ERROR: IBus: RX Invalid Length [%d - %02X]: ",
+                    "[%llu] ERROR: IBus: RX Invalid Length [%d - %02X]: %s\r\n",
                     ts,
                     msgLength,
-                    ibus->rxBuffer[1]
+                    ibus->rxBuffer[1],
+                    LogHex(ibus->rxBuffer, ibus->rxBufferIdx)
                 );
-                uint8_t idx;
-                for (idx = 0; idx < ibus->rxBufferIdx; idx++) {
-                    LogRawDebug(LOG_SOURCE_IBUS, "%02X ", ibus->rxBuffer[idx]);
-                }
-                LogRawDebug(LOG_SOURCE_IBUS, "\r\n");
                 ibus->rxBufferIdx = 0;
                 memset(ibus->rxBuffer, 0, IBUS_RX_BUFFER_SIZE);
                 CharQueueReset(&ibus->uart.rxQueue);
@@ -820,14 +816,24 @@ void IBusProcess(IBus_t *ibus)
                 uint8_t idx;
                 uint8_t pkt[msgLength];
                 memset(pkt, 0, msgLength);
-                long long unsigned int ts = (long long unsigned int) TimerGetMillis();
-                LogRawDebug(LOG_SOURCE_IBUS, "[%llu] DEBUG: IBus: RX[%d]: ", ts, msgLength);
                 for(idx = 0; idx < msgLength; idx++) {
                     pkt[idx] = ibus->rxBuffer[idx];
-                    LogRawDebug(LOG_SOURCE_IBUS, "%02X ", pkt[idx]);
                 }
-                if (memcmp(ibus->txBuffer[ibus->txBufferReadbackIdx], pkt, msgLength) == 0) {
-                    LogRawDebug(LOG_SOURCE_IBUS, "[SELF]");
+                uint8_t isSelf = memcmp(
+                    ibus->txBuffer[ibus->txBufferReadbackIdx],
+                    pkt,
+                    msgLength
+                ) == 0;
+                long long unsigned int ts = LogGetTimestamp();
+                LogRawDebug(
+                    LOG_SOURCE_IBUS,
+                    "[%llu] DEBUG: IBus: RX[%d]: %s%s\r\n",
+                    ts,
+                    msgLength,
+                    LogHex(pkt, msgLength),
+                    isSelf == 1 ? " [SELF]" : ""
+                );
+                if (isSelf == 1) {
                     memset(ibus->txBuffer[ibus->txBufferReadbackIdx], 0, msgLength);
                     if (ibus->txBufferReadbackIdx + 1 == IBUS_TX_BUFFER_SIZE) {
                         ibus->txBufferReadbackIdx = 0;
@@ -835,8 +841,8 @@ void IBusProcess(IBus_t *ibus)
                         ibus->txBufferReadbackIdx++;
                     }
                 }
-                LogRawDebug(LOG_SOURCE_IBUS, "\r\n");
                 if (IBusValidateChecksum(pkt) == 1) {
+                    TraceEvent(TRACE_EVENT_IBUS_RX, pkt, msgLength);
                     uint8_t srcSystem = pkt[IBUS_PKT_SRC];
                     if (srcSystem == IBUS_DEVICE_BLUEBUS &&
                         pkt[IBUS_PKT_DST] == IBUS_DEVICE_LOC
@@ -945,18 +951,14 @@ void IBusProcess(IBus_t *ibus)
         if ((now - ibus->rxLastStamp) > IBUS_RX_BUFFER_TIMEOUT ||
             (ibus->rxBufferIdx + 1) == IBUS_RX_BUFFER_SIZE
         ) {
-            long long unsigned int ts = (long long unsigned int) TimerGetMillis();
+            long long unsigned int ts = LogGetTimestamp();
             LogRawDebug(
                 LOG_SOURCE_IBUS,
-                "[%llu] ERROR: IBus: RX Buffer Timeout [%d]: ",
+                "[%llu] ERROR: IBus: RX Buffer Timeout [%d]: %s\r\n",
                 ts,
-                ibus->rxBufferIdx
+                ibus->rxBufferIdx,
+                LogHex(ibus->rxBuffer, ibus->rxBufferIdx)
             );
-            uint8_t idx;
-            for (idx = 0; idx < ibus->rxBufferIdx; idx++) {
-                LogRawDebug(LOG_SOURCE_IBUS, "%02X ", ibus->rxBuffer[idx]);
-            }
-            LogRawDebug(LOG_SOURCE_IBUS, "\r\n");
             ibus->rxBufferIdx = 0;
             memset(ibus->rxBuffer, 0, IBUS_RX_BUFFER_SIZE);
         }
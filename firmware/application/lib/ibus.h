@@ -15,6 +15,7 @@
 #include "event.h"
 #include "ibus.h"
 #include "timer.h"
+#include "trace.h"
 #include "uart.h"
 #include "utils.h"
 
@@ -479,6 +480,7 @@
 #define IBUS_TX_BUFFER_SIZE 16
 #define IBUS_RX_BUFFER_TIMEOUT 70 // At 9600 baud, we transmit ~1.5 byte/ms
 #define IBUS_TX_BUFFER_WAIT 7 // If we transmit faster, other modules may not hear us
+#define IBUS_RX_BATCH_SIZE 16 // Max bytes to process per main loop pass
 #define IBUS_TX_TIMEOUT_OFF 0
 #define IBUS_TX_TIMEOUT_ON 1
 #define IBUS_TX_TIMEOUT_DATA_SENT 2
@@ -5,163 +5,741 @@
  *     Implementation of logging mechanisms that we can use throughout the project
  */
 #include "log.h"
+static volatile CharQueue_t LogTXQueue;
+// Log calls format into this buffer rather than onto the stack. Logging is
+// not re-entrant, so it must not be used from an ISR
+static char LogBuffer[LOG_MESSAGE_SIZE];
+static uint32_t LogDroppedMessages = 0;
+static uint16_t LogDroppedMessagesPending = 0;
+// Bitmask of the enabled log sources, mirrored from the log setting
+uint8_t LogSources = 0;
+static uint8_t LogBinaryFrame[LOG_BINARY_FRAME_SIZE];
+static char LogHexBuffer[LOG_HEX_SIZE];
+static const char *LogLevelNames[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+// Sources that are rate limited and have repeated messages collapsed
+static uint8_t LogRateLimitSources = 0xFF;
+static LogRateLimit_t LogRateLimits[LOG_RATE_LIMIT_SITES];
+static LogSourceStats_t LogSourceStats[LOG_SOURCE_COUNT];
+static const char *LogLastFormat = 0;
+static uint8_t LogLastMessage[LOG_REPEAT_SIZE];
+static uint16_t LogLastLength = 0;
+static uint16_t LogRepeatCount = 0;
+static uint32_t LogRepeatTimestamp = 0;
 
 /**
- * LogMessage()
+ * LogInit()
  *     Description:
- *         Send a message over the system UART, for the given log level.
- *         Implicitly adds CRLF
+ *         Attach the log queue to the system UART so that log messages are
+ *         sent out by the TX ISR instead of blocking the caller
  *     Params:
- *         const char *type
- *         const char *data
+ *         None
  *     Returns:
  *         void
  */
-void LogMessage(const char *type, const char *data)
+void LogInit()
 {
     UART_t *debugger = UARTGetModuleHandler(SYSTEM_UART_MODULE);
     if (debugger != 0) {
-        char output[LOG_MESSAGE_SIZE] = {0};
-        long long unsigned int ts = (long long unsigned int) TimerGetMillis();
-        snprintf(output, LOG_MESSAGE_SIZE - 1 , "[%llu] %s: %s\r\n", ts, type, data);
-        UARTSendString(debugger, output);
+        CharQueueReset(&LogTXQueue);
+        UARTSetTXQueue(debugger, &LogTXQueue);
+        TimerRegisterScheduledTask(&LogTimerNotices, 0, LOG_NOTICE_INTERVAL);
     }
 }
 
 /**
- * LogRaw()
+ * LogLoadSources()
  *     Description:
- *         Sends the given data over to the debug UART.
+ *         Load the enabled log sources from the configuration into RAM so
+ *         that checking them does not go through the config layer. This must
+ *         be called again whenever the log setting changes.
  *     Params:
- *         const char *format - The string format
- *         va_args ...
+ *         None
  *     Returns:
  *         void
  */
-void LogRaw(const char *format, ...)
+void LogLoadSources()
+{
+    uint8_t sources = 0;
+    uint8_t system = 0;
+    // ConfigGetLog() also initializes the setting if it has never been set
+    for (system = 0; system < 8; system++) {
+        sources |= ConfigGetLog(system) << system;
+    }
+    LogSources = sources;
+}
+
+/**
+ * LogFlush()
+ *     Description:
+ *         Synchronously send everything waiting in the log queue
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void LogFlush()
 {
     UART_t *debugger = UARTGetModuleHandler(SYSTEM_UART_MODULE);
     if (debugger != 0) {
-        char buffer[LOG_MESSAGE_SIZE] = {0};
-        va_list args;
-        va_start(args, format);
-        vsnprintf(buffer, LOG_MESSAGE_SIZE - 1, format, args);
-        va_end(args);
-        UARTSendString(debugger, buffer);
+        UARTFlush(debugger);
     }
 }
 
 /**
- * LogRawDebug()
+ * LogSetSynchronous()
  *     Description:
- *         Sends the given data over to the debug UART.
+ *         Flush the log queue and detach it so that all further log messages
+ *         are written out before the log call returns. This is for contexts
+ *         in which the TX ISR cannot run, like trap handlers.
  *     Params:
- *         uint8_t source - The source system
- *         const char *format - The string format
- *         va_args ...
+ *         None
  *     Returns:
  *         void
  */
-void LogRawDebug(uint8_t source, const char *format, ...)
+void LogSetSynchronous()
 {
     UART_t *debugger = UARTGetModuleHandler(SYSTEM_UART_MODULE);
-    unsigned char canLog = ConfigGetLog(source);
-    if (debugger != 0 && canLog != 0) {
-        char buffer[LOG_MESSAGE_SIZE] = {0};
-        va_list args;
-        va_start(args, format);
-        vsnprintf(buffer, LOG_MESSAGE_SIZE - 1, format, args);
-        va_end(args);
-        UARTSendString(debugger, buffer);
+    if (debugger != 0) {
+        UARTSetTXQueue(debugger, 0);
     }
 }
 
 /**
- * LogDebug()
+ * LogGetDroppedMessages()
  *     Description:
- *         Send a debug message over the system UART
+ *         Get the number of messages dropped because the log queue was full
  *     Params:
- *         uint8_t source - The source system
- *         const char *format
- *         va_args ...
+ *         None
+ *     Returns:
+ *         uint32_t - The number of dropped messages
+ */
+uint32_t LogGetDroppedMessages()
+{
+    return LogDroppedMessages;
+}
+
+/**
+ * LogGetSourceStats()
+ *     Description:
+ *         Get the suppressed message counters for the given source
+ *     Params:
+ *         uint8_t source - The log source
+ *     Returns:
+ *         LogSourceStats_t * - The counters, or 0 for an invalid source
+ */
+LogSourceStats_t *LogGetSourceStats(uint8_t source)
+{
+    if (source >= LOG_SOURCE_COUNT) {
+        return 0;
+    }
+    return &LogSourceStats[source];
+}
+
+/**
+ * LogRateLimitEnabled()
+ *     Description:
+ *         Check if rate limiting is enabled for the given source
+ *     Params:
+ *         uint8_t source - The log source
+ *     Returns:
+ *         uint8_t - 1 if rate limiting is enabled, 0 otherwise
+ */
+uint8_t LogRateLimitEnabled(uint8_t source)
+{
+    return (LogRateLimitSources >> source) & 1;
+}
+
+/**
+ * LogSetRateLimit()
+ *     Description:
+ *         Enable or disable rate limiting for the given source
+ *     Params:
+ *         uint8_t source - The log source
+ *         uint8_t enabled - 1 to enable rate limiting, 0 to disable it
  *     Returns:
  *         void
  */
-void LogDebug(uint8_t source, const char *format, ...)
+void LogSetRateLimit(uint8_t source, uint8_t enabled)
 {
-    unsigned char canLog = ConfigGetLog(source);
-    if (canLog != 0) {
-        char buffer[LOG_MESSAGE_SIZE] = {0};
-        va_list args;
-        va_start(args, format);
-        vsnprintf(buffer, LOG_MESSAGE_SIZE - 1, format, args);
-        va_end(args);
-        LogMessage("DEBUG", buffer);
+    if (enabled == 1) {
+        LogRateLimitSources |= 1 << source;
+    } else {
+        LogRateLimitSources &= ~(1 << source);
     }
 }
 
 /**
- * LogError()
+ * LogGetTimestamp()
  *     Description:
- *         Send an error message over the system UART
- *         va_args ...
+ *         Get the timestamp to prefix log messages with. This is milliseconds
+ *         since boot unless microsecond timestamps have been enabled, in which
+ *         case it wraps every ~71 minutes.
  *     Params:
- *         const char *format
+ *         None
+ *     Returns:
+ *         long long unsigned int - The timestamp
+ */
+long long unsigned int LogGetTimestamp()
+{
+    if (LogSourceEnabled(CONFIG_DEVICE_LOG_TIMESTAMP_US)) {
+        return (long long unsigned int) TimerGetMicroseconds();
+    }
+    return (long long unsigned int) TimerGetMillis();
+}
+
+/**
+ * LogHex()
+ *     Description:
+ *         Format bytes as space separated hex, so that a frame can be dumped
+ *         with a single log call instead of one per byte. The text is kept in
+ *         a buffer that the next call overwrites, so use it once per message.
+ *     Params:
+ *         const uint8_t *data - The bytes
+ *         uint16_t length - The number of bytes
+ *     Returns:
+ *         const char * - The hex text
+ */
+const char *LogHex(const uint8_t *data, uint16_t length)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    uint16_t count = length;
+    uint16_t idx = 0;
+    char *text = LogHexBuffer;
+    if (count > LOG_HEX_DATA_MAX) {
+        count = LOG_HEX_DATA_MAX;
+    }
+    for (idx = 0; idx < count; idx++) {
+        if (idx > 0) {
+            *text++ = ' ';
+        }
+        *text++ = digits[data[idx] >> 4];
+        *text++ = digits[data[idx] & 0x0F];
+    }
+    if (length > count) {
+        *text++ = ' ';
+        *text++ = '.';
+        *text++ = '.';
+    }
+    *text = '\0';
+    return LogHexBuffer;
+}
+
+/**
+ * LogReserve()
+ *     Description:
+ *         Check that the log queue has room for a message of the given
+ *         length. If it does not, the message is counted as dropped. Once
+ *         there is room again, a marker with the number of dropped messages
+ *         is sent ahead of the next message.
+ *     Params:
+ *         UART_t *debugger - The system UART
+ *         uint16_t length - The length of the message
+ *     Returns:
+ *         uint8_t - 1 if the message may be sent, 0 if it was dropped
+ */
+static uint8_t LogReserve(UART_t *debugger, uint16_t length)
+{
+    // Without a queue, everything is synchronous and nothing is dropped
+    if (debugger->txQueue == 0) {
+        return 1;
+    }
+    char marker[LOG_DROPPED_MARKER_SIZE] = {0};
+    if (LogDroppedMessagesPending > 0) {
+        snprintf(
+            marker,
+            LOG_DROPPED_MARKER_SIZE,
+            "[%llu] WARNING: %u messages dropped\r\n",
+            LogGetTimestamp(),
+            LogDroppedMessagesPending
+        );
+        length += strlen(marker);
+    }
+    if (length > UARTGetTXQueueSpace(debugger)) {
+        LogDroppedMessages++;
+        if (LogDroppedMessagesPending < 0xFFFF) {
+            LogDroppedMessagesPending++;
+        }
+        return 0;
+    }
+    if (LogDroppedMessagesPending > 0) {
+        UARTSendString(debugger, marker);
+        LogDroppedMessagesPending = 0;
+    }
+    return 1;
+}
+
+/**
+ * LogSend()
+ *     Description:
+ *         Queue the given strings as a single message, or drop the whole
+ *         message if the log queue does not have room for it
+ *     Params:
+ *         UART_t *debugger - The system UART
+ *         const char *header - The message header, may be 0
+ *         const char *data - The message
+ *         const char *footer - The message footer, may be 0
+ *     Returns:
+ *         void
+ */
+static void LogSend(
+    UART_t *debugger,
+    const char *header,
+    const char *data,
+    const char *footer
+) {
+    uint16_t length = strlen(data);
+    if (header != 0) {
+        length += strlen(header);
+    }
+    if (footer != 0) {
+        length += strlen(footer);
+    }
+    if (LogReserve(debugger, length) == 0) {
+        return;
+    }
+    if (header != 0) {
+        UARTSendString(debugger, (char *) header);
+    }
+    UARTSendString(debugger, (char *) data);
+    if (footer != 0) {
+        UARTSendString(debugger, (char *) footer);
+    }
+}
+
+/**
+ * LogEncodeBinary()
+ *     Description:
+ *         Encode the given format arguments into a binary log frame in
+ *         LogBinaryFrame. Only integer, character and string conversions are
+ *         supported.
+ *     Params:
+ *         uint8_t level - The log level, LOG_LEVEL_NONE for raw data
+ *         const char *format - The string format
+ *         va_list args - The format arguments
+ *     Returns:
+ *         uint16_t - The length of the frame, or 0 if the format could not be
+ *             encoded and has to be sent as text instead
+ */
+static uint16_t LogEncodeBinary(uint8_t level, const char *format, va_list args)
+{
+    uint8_t *frame = LogBinaryFrame;
+    uint16_t idx = 0;
+    uint16_t id = (uint16_t) (uintptr_t) format;
+    frame[idx++] = LOG_BINARY_FRAME_START;
+    frame[idx++] = 0x00;
+    frame[idx++] = level;
+    frame[idx++] = id & 0xFF;
+    frame[idx++] = id >> 8;
+    if (level != LOG_LEVEL_NONE) {
+        uint32_t ts = (uint32_t) LogGetTimestamp();
+        uint8_t i = 0;
+        for (i = 0; i < 4; i++) {
+            frame[idx++] = (ts >> (i * 8)) & 0xFF;
+        }
+    }
+    const char *c = format;
+    while (*c != '\0') {
+        if (*c++ != '%') {
+            continue;
+        }
+        if (*c == '%') {
+            c++;
+            continue;
+        }
+        // Skip the flags, width and precision
+        while (*c != '\0' && strchr("-+ #0123456789.", *c) != 0) {
+            c++;
+        }
+        uint8_t size = 2;
+        while (*c == 'l' || *c == 'h') {
+            if (*c == 'l') {
+                size = (size == 2) ? 4 : 8;
+            }
+            c++;
+        }
+        if (*c == 's') {
+            const char *str = va_arg(args, const char *);
+            if (idx > LOG_BINARY_LENGTH_MAX + 1) {
+                return 0;
+            }
+            // Always leave room for the terminator
+            while (*str != '\0' && idx < LOG_BINARY_LENGTH_MAX + 1) {
+                frame[idx++] = *str++;
+            }
+            frame[idx++] = '\0';
+        } else if (strchr("cdiuxXo", *c) != 0 && *c != '\0') {
+            if (idx + size > LOG_BINARY_LENGTH_MAX + 2) {
+                return 0;
+            }
+            long long unsigned int value = 0;
+            if (size == 8) {
+                value = va_arg(args, long long unsigned int);
+            } else if (size == 4) {
+                value = va_arg(args, long unsigned int);
+            } else {
+                value = va_arg(args, unsigned int);
+            }
+            uint8_t i = 0;
+            for (i = 0; i < size; i++) {
+                frame[idx++] = (value >> (i * 8)) & 0xFF;
+            }
+        } else {
+            return 0;
+        }
+        if (*c != '\0') {
+            c++;
+        }
+    }
+    frame[1] = idx - 2;
+    uint8_t checksum = 0;
+    uint16_t i = 0;
+    for (i = 1; i < idx; i++) {
+        checksum ^= frame[i];
+    }
+    frame[idx++] = checksum;
+    return idx;
+}
+
+/**
+ * LogNotice()
+ *     Description:
+ *         Send an informational message about suppressed log messages. This
+ *         does not use LogBuffer, so it is safe to call while the buffer holds
+ *         a formatted message.
+ *     Params:
+ *         const char *format - The notice
  *         va_args ...
  *     Returns:
  *         void
  */
-void LogError(const char *format, ...)
+static void LogNotice(const char *format, ...)
 {
-    char buffer[LOG_MESSAGE_SIZE] = {0};
+    char notice[LOG_DROPPED_MARKER_SIZE] = {0};
     va_list args;
     va_start(args, format);
-    vsnprintf(buffer, LOG_MESSAGE_SIZE - 1, format, args);
+    vsnprintf(notice, LOG_DROPPED_MARKER_SIZE, format, args);
     va_end(args);
-    LogMessage("ERROR", buffer);
+    LogMessage("INFO", notice);
+}
+
+/**
+ * LogRateLimitReport()
+ *     Description:
+ *         Report the messages that a call site had suppressed, naming the
+ *         call site by its format string since no message of it follows
+ *     Params:
+ *         LogRateLimit_t *site - The bucket of the call site
+ *     Returns:
+ *         void
+ */
+static void LogRateLimitReport(LogRateLimit_t *site)
+{
+    if (site->suppressed > 0) {
+        LogNotice("Rate limited %u of '%s'", site->suppressed, site->format);
+        site->suppressed = 0;
+    }
+}
+
+/**
+ * LogRateLimitRefill()
+ *     Description:
+ *         Add the tokens that a bucket earned since it was last refilled, at
+ *         one token per LOG_RATE_LIMIT_INTERVAL up to LOG_RATE_LIMIT_BURST
+ *     Params:
+ *         LogRateLimit_t *site - The bucket of the call site
+ *         uint32_t now - The current time
+ *     Returns:
+ *         void
+ */
+static void LogRateLimitRefill(LogRateLimit_t *site, uint32_t now)
+{
+    uint32_t refill = (now - site->refillTimestamp) / LOG_RATE_LIMIT_INTERVAL;
+    if (refill > 0) {
+        if (site->tokens + refill >= LOG_RATE_LIMIT_BURST) {
+            site->tokens = LOG_RATE_LIMIT_BURST;
+            site->refillTimestamp = now;
+        } else {
+            site->tokens += refill;
+            site->refillTimestamp += refill * LOG_RATE_LIMIT_INTERVAL;
+        }
+    }
+}
+
+/**
+ * LogRateLimitFind()
+ *     Description:
+ *         Find the bucket of the given call site by its format string,
+ *         starting at the slot its address hashes to. A call site without a
+ *         bucket takes the first unused one, or one whose bucket is full and
+ *         has nothing to report, since a fresh bucket would be the same.
+ *         Buckets are never shared between call sites.
+ *     Params:
+ *         const char *format - The format string of the call site
+ *         uint32_t now - The current time
+ *     Returns:
+ *         LogRateLimit_t * - The bucket, 0 if every bucket is in use
+ */
+static LogRateLimit_t *LogRateLimitFind(const char *format, uint32_t now)
+{
+    uint8_t start = ((uint16_t) (uintptr_t) format >> 1) % LOG_RATE_LIMIT_SITES;
+    uint8_t probe = 0;
+    LogRateLimit_t *unused = 0;
+    for (probe = 0; probe < LOG_RATE_LIMIT_SITES; probe++) {
+        LogRateLimit_t *site = &LogRateLimits[
+            (start + probe) % LOG_RATE_LIMIT_SITES
+        ];
+        if (site->format == format) {
+            return site;
+        }
+        if (site->format == 0) {
+            // Buckets are never emptied, so the call site is not further on
+            if (unused == 0) {
+                unused = site;
+            }
+            break;
+        }
+        if (unused == 0) {
+            LogRateLimitRefill(site, now);
+            if (site->tokens == LOG_RATE_LIMIT_BURST && site->suppressed == 0) {
+                unused = site;
+            }
+        }
+    }
+    if (unused != 0) {
+        unused->format = format;
+        unused->tokens = LOG_RATE_LIMIT_BURST;
+        unused->refillTimestamp = now;
+        unused->suppressed = 0;
+    }
+    return unused;
+}
+
+/**
+ * LogRateLimitTake()
+ *     Description:
+ *         Take a token from the bucket of the given call site. If every
+ *         bucket is in use by a call site that is being limited, the message
+ *         is sent rather than charged to another call site.
+ *     Params:
+ *         uint8_t source - The log source
+ *         const char *format - The format string of the call site
+ *     Returns:
+ *         uint8_t - 1 if the message may be sent, 0 if it was suppressed
+ */
+static uint8_t LogRateLimitTake(uint8_t source, const char *format)
+{
+    uint32_t now = TimerGetMillis();
+    LogRateLimit_t *site = LogRateLimitFind(format, now);
+    if (site == 0) {
+        return 1;
+    }
+    LogRateLimitRefill(site, now);
+    if (site->tokens == 0) {
+        if (site->suppressed < 0xFFFF) {
+            site->suppressed++;
+        }
+        LogSourceStats[source].rateLimited++;
+        return 0;
+    }
+    site->tokens--;
+    if (site->suppressed > 0) {
+        LogNotice("Rate limited %u of the following message", site->suppressed);
+        site->suppressed = 0;
+    }
+    return 1;
+}
+
+/**
+ * LogMessage()
+ *     Description:
+ *         Send a message over the system UART, for the given log level.
+ *         Implicitly adds CRLF
+ *     Params:
+ *         const char *type
+ *         const char *data
+ *     Returns:
+ *         void
+ */
+void LogMessage(const char *type, const char *data)
+{
+    UART_t *debugger = UARTGetModuleHandler(SYSTEM_UART_MODULE);
+    if (debugger != 0) {
+        char header[LOG_HEADER_SIZE] = {0};
+        snprintf(header, LOG_HEADER_SIZE, "[%llu] %s: ", LogGetTimestamp(), type);
+        LogSend(debugger, header, data, "\r\n");
+    }
 }
 
 /**
- * LogInfo()
+ * LogRaw()
  *     Description:
- *         Send an info message over the system UART
+ *         Sends the given data over to the debug UART. This is used for CLI
+ *         output, so it waits for room in the log queue rather than
+ *         dropping the message.
+ *     Params:
+ *         const char *format - The string format
  *         va_args ...
+ *     Returns:
+ *         void
+ */
+void LogRaw(const char *format, ...)
+{
+    UART_t *debugger = UARTGetModuleHandler(SYSTEM_UART_MODULE);
+    if (debugger != 0) {
+        va_list args;
+        va_start(args, format);
+        vsnprintf(LogBuffer, LOG_MESSAGE_SIZE - 1, format, args);
+        va_end(args);
+        UARTSendString(debugger, LogBuffer);
+    }
+}
+
+/**
+ * LogWrite()
+ *     Description:
+ *         Send a message of the given level. This backs the LogDebug(),
+ *         LogInfo(), LogWarning() and LogError() macros, which have already
+ *         checked the level and source. If rate limiting is enabled for the
+ *         source, debug and info messages are dropped when their call site
+ *         has run out of tokens, or when they repeat the previous message
+ *         exactly. Warnings and errors are always sent.
  *     Params:
- *         uint8_t source - The source system
+ *         uint8_t source - The log source
+ *         uint8_t level - The log level
  *         const char *format
  *         va_args ...
  *     Returns:
  *         void
  */
-void LogInfo(uint8_t source, const char *format, ...)
+void LogWrite(uint8_t source, uint8_t level, const char *format, ...)
 {
-    unsigned char canLog = ConfigGetLog(source);
-    if (canLog != 0) {
-        char buffer[LOG_MESSAGE_SIZE] = {0};
-        va_list args;
+    UART_t *debugger = UARTGetModuleHandler(SYSTEM_UART_MODULE);
+    if (debugger == 0) {
+        return;
+    }
+    uint8_t limited = 0;
+    if (level < LOG_LEVEL_WARNING) {
+        limited = LogRateLimitEnabled(source);
+    }
+    if (limited == 1 && LogRateLimitTake(source, format) == 0) {
+        return;
+    }
+    va_list args;
+    uint16_t frameLength = 0;
+    uint8_t *message = 0;
+    uint16_t length = 0;
+    if (LogSourceEnabled(CONFIG_DEVICE_LOG_BINARY)) {
+        va_start(args, format);
+        frameLength = LogEncodeBinary(level, format, args);
+        va_end(args);
+    }
+    if (frameLength > 0) {
+        // Leave the timestamp and checksum out of the comparison
+        message = &LogBinaryFrame[LOG_BINARY_ARGS_OFFSET];
+        length = frameLength - LOG_BINARY_ARGS_OFFSET - 1;
+    } else {
         va_start(args, format);
-        vsnprintf(buffer, LOG_MESSAGE_SIZE - 1, format, args);
+        vsnprintf(LogBuffer, LOG_MESSAGE_SIZE - 1, format, args);
         va_end(args);
-        LogMessage("INFO", buffer);
+        message = (uint8_t *) LogBuffer;
+        length = strlen(LogBuffer);
+    }
+    if (limited == 1 &&
+        format == LogLastFormat &&
+        length == LogLastLength &&
+        memcmp(message, LogLastMessage, length) == 0
+    ) {
+        if (LogRepeatCount == 0) {
+            LogRepeatTimestamp = TimerGetMillis();
+        }
+        LogRepeatCount++;
+        LogSourceStats[source].repeated++;
+        return;
+    }
+    if (LogRepeatCount > 0) {
+        LogNotice("Last message repeated %u times", LogRepeatCount);
+        LogRepeatCount = 0;
+    }
+    LogLastFormat = format;
+    LogLastLength = length;
+    if (length <= LOG_REPEAT_SIZE) {
+        memcpy(LogLastMessage, message, length);
+    } else {
+        // Too long to keep, so it cannot be repeated
+        LogLastFormat = 0;
+    }
+    if (frameLength > 0) {
+        if (LogReserve(debugger, frameLength) == 1) {
+            UARTSendData(debugger, LogBinaryFrame, frameLength);
+        }
+    } else {
+        LogMessage(LogLevelNames[level], LogBuffer);
     }
 }
 
 /**
- * LogWarning()
+ * LogWriteRaw()
  *     Description:
- *         Send a warning message over the system UART
+ *         Send the given data without a header. This backs the LogRawDebug()
+ *         macro. Unlike LogRaw(), the data is dropped if the log queue is
+ *         full. Raw data is never rate limited, since it is usually part of
+ *         a larger message.
  *     Params:
  *         const char *format
  *         va_args ...
  *     Returns:
  *         void
  */
-void LogWarning(const char *format, ...)
+void LogWriteRaw(const char *format, ...)
 {
-    char buffer[LOG_MESSAGE_SIZE] = {0};
+    UART_t *debugger = UARTGetModuleHandler(SYSTEM_UART_MODULE);
+    if (debugger == 0) {
+        return;
+    }
     va_list args;
+    if (LogSourceEnabled(CONFIG_DEVICE_LOG_BINARY)) {
+        va_start(args, format);
+        uint16_t frameLength = LogEncodeBinary(LOG_LEVEL_NONE, format, args);
+        va_end(args);
+        if (frameLength > 0) {
+            if (LogReserve(debugger, frameLength) == 1) {
+                UARTSendData(debugger, LogBinaryFrame, frameLength);
+            }
+            return;
+        }
+    }
     va_start(args, format);
-    vsnprintf(buffer, LOG_MESSAGE_SIZE - 1, format, args);
+    vsnprintf(LogBuffer, LOG_MESSAGE_SIZE - 1, format, args);
     va_end(args);
-    LogMessage("WARNING", buffer);
+    LogSend(debugger, 0, LogBuffer, 0);
+}
+
+/**
+ * LogTimerNotices()
+ *     Description:
+ *         Report the repeated and rate limited messages that no later message
+ *         has reported, so that the counts are not held back indefinitely
+ *         when a call site falls silent. Repeats are reported every
+ *         LOG_NOTICE_INTERVAL and call sites once they could have sent again.
+ *     Params:
+ *         void *ctx - Unused
+ *     Returns:
+ *         void
+ */
+void LogTimerNotices(void *ctx)
+{
+    uint32_t now = TimerGetMillis();
+    uint8_t idx = 0;
+    if (LogRepeatCount > 0 && now - LogRepeatTimestamp >= LOG_NOTICE_INTERVAL) {
+        LogNotice("Last message repeated %u times", LogRepeatCount);
+        LogRepeatCount = 0;
+    }
+    for (idx = 0; idx < LOG_RATE_LIMIT_SITES; idx++) {
+        LogRateLimit_t *site = &LogRateLimits[idx];
+        if (site->suppressed > 0 &&
+            now - site->refillTimestamp >= LOG_RATE_LIMIT_INTERVAL
+        ) {
+            LogRateLimitReport(site);
+        }
+    }
 }
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include "../mappings.h"
 #include "config.h"
 #include "timer.h"
@@ -17,15 +18,127 @@
 // Metadata is the largest single buffer at 384 bytes, so add another 32 bytes
 // to that in order to get a usable buffer size
 #define LOG_MESSAGE_SIZE 416
+// "[timestamp] WARNING: " and similar
+#define LOG_HEADER_SIZE 40
+#define LOG_DROPPED_MARKER_SIZE 64
+// Binary log frames replace the formatted text with the address of the
+// format string and the raw arguments. utility/log_decoder.py rebuilds the
+// text using the format strings from the firmware image. Frames are:
+// SOH, Length, Level, ID LSB, ID MSB, [Timestamp (4 bytes LE)], Args, XOR
+// The length covers Level through Args, the XOR covers Length through Args
+// and the timestamp is omitted for raw (LOG_LEVEL_NONE) frames. Integer
+// arguments are little-endian and 2, 4 or 8 bytes wide depending on the
+// length modifier. Strings are NUL terminated and may be truncated.
+#define LOG_BINARY_FRAME_START 0x01
+#define LOG_BINARY_FRAME_SIZE 258
+#define LOG_BINARY_LENGTH_MAX 255
+// Offset of the arguments in a frame with a timestamp
+#define LOG_BINARY_ARGS_OFFSET 9
+// Bytes dumped by LogHex(), which covers the longest IBus message. Longer
+// dumps are cut off and end in "..".
+#define LOG_HEX_DATA_MAX 96
+#define LOG_HEX_SIZE ((LOG_HEX_DATA_MAX * 3) + 3)
+// Debug and info call sites each get a token bucket, keyed by their format
+// string, that holds LOG_RATE_LIMIT_BURST messages and refills with one
+// message every LOG_RATE_LIMIT_INTERVAL milliseconds. Up to
+// LOG_RATE_LIMIT_SITES call sites are tracked at a time.
+#define LOG_RATE_LIMIT_SITES 32
+#define LOG_RATE_LIMIT_BURST 5
+#define LOG_RATE_LIMIT_INTERVAL 1000
+// Messages up to this length are compared to the previous one to collapse
+// repeats, longer messages are always sent
+#define LOG_REPEAT_SIZE 64
+// How often suppressed and repeated messages are reported if nothing else
+// reports them first
+#define LOG_NOTICE_INTERVAL 1000
 #define LOG_SOURCE_BT CONFIG_DEVICE_LOG_BT
 #define LOG_SOURCE_IBUS CONFIG_DEVICE_LOG_IBUS
 #define LOG_SOURCE_SYSTEM CONFIG_DEVICE_LOG_SYSTEM
 #define LOG_SOURCE_UI CONFIG_DEVICE_LOG_UI
+#define LOG_SOURCE_COUNT 8
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+// Log calls below this level are compiled out entirely, arguments included.
+// Override it from the build flags, i.e. -DLOG_LEVEL=LOG_LEVEL_WARNING
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#define LogSourceEnabled(source) (((LogSources >> (source)) & 1) != 0)
+extern uint8_t LogSources;
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LogDebug(source, ...) \
+    do { if (LogSourceEnabled(source)) { LogWrite(source, LOG_LEVEL_DEBUG, __VA_ARGS__); } } while (0)
+#define LogRawDebug(source, ...) \
+    do { if (LogSourceEnabled(source)) { LogWriteRaw(__VA_ARGS__); } } while (0)
+#else
+#define LogDebug(source, ...) do { } while (0)
+#define LogRawDebug(source, ...) do { } while (0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LogInfo(source, ...) \
+    do { if (LogSourceEnabled(source)) { LogWrite(source, LOG_LEVEL_INFO, __VA_ARGS__); } } while (0)
+#else
+#define LogInfo(source, ...) do { } while (0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LogWarning(...) LogWrite(LOG_SOURCE_SYSTEM, LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LogWarning(...) do { } while (0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LogError(...) LogWrite(LOG_SOURCE_SYSTEM, LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LogError(...) do { } while (0)
+#endif
+
+/**
+ * LogRateLimit_t
+ *     Description:
+ *         The token bucket of a log call site
+ *     Fields:
+ *         const char *format - The format string of the call site, 0 if
+ *             the bucket is unused
+ *         uint32_t refillTimestamp - When the bucket was last refilled
+ *         uint8_t tokens - The number of messages that may still be sent
+ *         uint16_t suppressed - Messages of the call site suppressed since
+ *             the last one sent
+ */
+typedef struct LogRateLimit_t {
+    const char *format;
+    uint32_t refillTimestamp;
+    uint8_t tokens;
+    uint16_t suppressed;
+} LogRateLimit_t;
+
+/**
+ * LogSourceStats_t
+ *     Description:
+ *         Counters for the messages of a source that were not sent
+ *     Fields:
+ *         uint32_t rateLimited - Messages suppressed by the rate limit
+ *         uint32_t repeated - Messages collapsed as repeats of the last one
+ */
+typedef struct LogSourceStats_t {
+    uint32_t rateLimited;
+    uint32_t repeated;
+} LogSourceStats_t;
+
+void LogInit();
+void LogLoadSources();
+void LogFlush();
+void LogSetSynchronous();
+uint32_t LogGetDroppedMessages();
+LogSourceStats_t *LogGetSourceStats(uint8_t);
+uint8_t LogRateLimitEnabled(uint8_t);
+void LogSetRateLimit(uint8_t, uint8_t);
+void LogTimerNotices(void *);
+const char *LogHex(const uint8_t *, uint16_t);
+long long unsigned int LogGetTimestamp();
 void LogMessage(const char *, const char *);
 void LogRaw(const char *, ...);
-void LogRawDebug(uint8_t, const char *, ...);
-void LogError(const char *, ...);
-void LogDebug(uint8_t, const char *, ...);
-void LogInfo(uint8_t, const char *, ...);
-void LogWarning(const char *, ...);
+void LogWrite(uint8_t, uint8_t, const char *, ...);
+void LogWriteRaw(const char *, ...);
 #endif /* LOG_H */
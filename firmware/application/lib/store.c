@@ -0,0 +1,410 @@
+/*
+ * File: store.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Log-structured record store for frequently changing values. Records
+ *     are appended to one of two EEPROM banks instead of being rewritten in
+ *     place, and the live records are compacted into the other bank while
+ *     idle once the active one is nearly full.
+ */
+#include "store.h"
+// The record number of the latest record for each key in the active bank
+static uint8_t StoreIndex[STORE_KEY_COUNT] = {STORE_RECORD_NONE};
+static uint8_t StoreBank = 0;
+static uint16_t StoreGeneration = 0;
+static uint16_t StoreSequence = 0;
+static uint8_t StoreNextRecord = STORE_RECORD_HEADER + 1;
+// Progress of erasing the inactive bank, STORE_BANK_SIZE once it is erased
+static uint16_t StoreEraseOffset = STORE_BANK_SIZE;
+
+/**
+ * StoreGetAddress()
+ *     Description:
+ *         Get the EEPROM address of a record
+ *     Params:
+ *         uint8_t bank - The bank
+ *         uint8_t record - The record number within the bank
+ *     Returns:
+ *         uint32_t - The EEPROM address
+ */
+static uint32_t StoreGetAddress(uint8_t bank, uint8_t record)
+{
+    return STORE_START_ADDRESS +
+        ((uint32_t) bank * STORE_BANK_SIZE) +
+        ((uint32_t) record * STORE_RECORD_SIZE);
+}
+
+/**
+ * StoreCalculateCRC()
+ *     Description:
+ *         Calculate the CRC8 of a record, excluding the CRC itself
+ *     Params:
+ *         StoreRecord_t *record - The record
+ *     Returns:
+ *         uint8_t - The CRC
+ */
+static uint8_t StoreCalculateCRC(StoreRecord_t *record)
+{
+    uint8_t *data = (uint8_t *) record;
+    uint8_t crc = 0x00;
+    uint8_t idx = 0;
+    for (idx = 0; idx < offsetof(StoreRecord_t, crc); idx++) {
+        crc ^= data[idx];
+        uint8_t bit = 0;
+        for (bit = 0; bit < 8; bit++) {
+            if ((crc & 0x80) != 0) {
+                crc = (crc << 1) ^ STORE_CRC_POLYNOMIAL;
+            } else {
+                crc = crc << 1;
+            }
+        }
+    }
+    return crc;
+}
+
+/**
+ * StoreIsErased()
+ *     Description:
+ *         Check if every byte of the given data is erased
+ *     Params:
+ *         uint8_t *data - The data
+ *         uint8_t length - The length of the data
+ *     Returns:
+ *         uint8_t - 1 if the data is erased, 0 otherwise
+ */
+static uint8_t StoreIsErased(uint8_t *data, uint8_t length)
+{
+    uint8_t idx = 0;
+    for (idx = 0; idx < length; idx++) {
+        if (data[idx] != STORE_ERASED) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * StoreReadRecord()
+ *     Description:
+ *         Read a record from the EEPROM and verify it
+ *     Params:
+ *         uint8_t bank - The bank
+ *         uint8_t record - The record number within the bank
+ *         StoreRecord_t *data - The record to read into
+ *     Returns:
+ *         uint8_t - 1 if the record is valid, 0 otherwise
+ */
+static uint8_t StoreReadRecord(uint8_t bank, uint8_t record, StoreRecord_t *data)
+{
+    EEPROMReadBytes(
+        StoreGetAddress(bank, record),
+        (uint8_t *) data,
+        sizeof(StoreRecord_t)
+    );
+    if (data->crc != StoreCalculateCRC(data) ||
+        data->length > STORE_RECORD_DATA_SIZE
+    ) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * StoreWriteRecord()
+ *     Description:
+ *         Seal a record with its CRC and write it to the EEPROM
+ *     Params:
+ *         uint8_t bank - The bank
+ *         uint8_t record - The record number within the bank
+ *         StoreRecord_t *data - The record to write
+ *     Returns:
+ *         void
+ */
+static void StoreWriteRecord(uint8_t bank, uint8_t record, StoreRecord_t *data)
+{
+    data->crc = StoreCalculateCRC(data);
+    EEPROMWriteBytes(
+        StoreGetAddress(bank, record),
+        (uint8_t *) data,
+        sizeof(StoreRecord_t)
+    );
+}
+
+/**
+ * StoreReadHeader()
+ *     Description:
+ *         Read the header of a bank
+ *     Params:
+ *         uint8_t bank - The bank
+ *         uint16_t *generation - Set to the generation of the bank
+ *     Returns:
+ *         uint8_t - 1 if the bank has a valid header, 0 otherwise
+ */
+static uint8_t StoreReadHeader(uint8_t bank, uint16_t *generation)
+{
+    StoreRecord_t header;
+    if (StoreReadRecord(bank, STORE_RECORD_HEADER, &header) == 0 ||
+        header.key != STORE_KEY_HEADER ||
+        header.data[0] != STORE_HEADER_MAGIC_MSB ||
+        header.data[1] != STORE_HEADER_MAGIC_LSB
+    ) {
+        return 0;
+    }
+    *generation = header.sequence;
+    return 1;
+}
+
+/**
+ * StoreEraseNext()
+ *     Description:
+ *         Erase the next chunk of the inactive bank. Chunks that are
+ *         already erased are not written again. The header is erased first,
+ *         so that a partially erased bank is never taken as valid.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if the EEPROM was written, 0 otherwise
+ */
+static uint8_t StoreEraseNext()
+{
+    uint8_t chunk[STORE_ERASE_SIZE];
+    uint32_t address = StoreGetAddress(StoreBank ^ 1, 0) + StoreEraseOffset;
+    StoreEraseOffset += STORE_ERASE_SIZE;
+    EEPROMReadBytes(address, chunk, STORE_ERASE_SIZE);
+    if (StoreIsErased(chunk, STORE_ERASE_SIZE) == 1) {
+        return 0;
+    }
+    memset(chunk, STORE_ERASED, STORE_ERASE_SIZE);
+    EEPROMWriteBytes(address, chunk, STORE_ERASE_SIZE);
+    return 1;
+}
+
+/**
+ * StoreCompact()
+ *     Description:
+ *         Copy the latest record of every key into the inactive bank, then
+ *         write its header to make it the active bank. Until the header is
+ *         written, the current bank remains the valid one.
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+static void StoreCompact()
+{
+    uint8_t target = StoreBank ^ 1;
+    uint8_t index[STORE_KEY_COUNT] = {STORE_RECORD_NONE};
+    uint8_t next = STORE_RECORD_HEADER + 1;
+    uint8_t key = 0;
+    StoreRecord_t record;
+    while (StoreEraseOffset < STORE_BANK_SIZE) {
+        StoreEraseNext();
+    }
+    for (key = 0; key < STORE_KEY_COUNT; key++) {
+        if (StoreIndex[key] == STORE_RECORD_NONE) {
+            continue;
+        }
+        if (StoreReadRecord(StoreBank, StoreIndex[key], &record) == 0) {
+            LogError("Store: Dropping unreadable record for key %d", key);
+            continue;
+        }
+        record.sequence = next;
+        StoreWriteRecord(target, next, &record);
+        index[key] = next++;
+    }
+    memset(&record, STORE_ERASED, sizeof(StoreRecord_t));
+    record.key = STORE_KEY_HEADER;
+    record.length = 2;
+    record.sequence = StoreGeneration + 1;
+    record.data[0] = STORE_HEADER_MAGIC_MSB;
+    record.data[1] = STORE_HEADER_MAGIC_LSB;
+    StoreWriteRecord(target, STORE_RECORD_HEADER, &record);
+    // The previous bank is stale now and is erased while the loop is idle
+    StoreBank = target;
+    StoreGeneration++;
+    StoreSequence = next - 1;
+    StoreNextRecord = next;
+    StoreEraseOffset = 0;
+    memcpy(StoreIndex, index, sizeof(StoreIndex));
+}
+
+/**
+ * StoreInit()
+ *     Description:
+ *         Find the active bank and rebuild the index with a single scan of
+ *         its records. If neither bank is valid, the store is formatted.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if an existing store was found, 0 if it was formatted
+ */
+uint8_t StoreInit()
+{
+    uint16_t generations[STORE_BANK_COUNT] = {0};
+    uint8_t valid[STORE_BANK_COUNT] = {0};
+    uint8_t bank = 0;
+    for (bank = 0; bank < STORE_BANK_COUNT; bank++) {
+        valid[bank] = StoreReadHeader(bank, &generations[bank]);
+    }
+    memset(StoreIndex, STORE_RECORD_NONE, sizeof(StoreIndex));
+    if (valid[0] == 0 && valid[1] == 0) {
+        // Compacting from the "previous" bank formats bank 0 as generation 0
+        StoreBank = 1;
+        StoreGeneration = 0xFFFF;
+        StoreEraseOffset = 0;
+        StoreCompact();
+        LogInfo(LOG_SOURCE_SYSTEM, "Store: Formatted");
+        return 0;
+    }
+    if (valid[0] == 1 && valid[1] == 1) {
+        // Allow for the generation wrapping around
+        StoreBank = (int16_t) (generations[1] - generations[0]) > 0 ? 1 : 0;
+    } else {
+        StoreBank = valid[1];
+    }
+    StoreGeneration = generations[StoreBank];
+    StoreSequence = 0;
+    StoreNextRecord = STORE_RECORD_HEADER + 1;
+    // The inactive bank may hold a stale copy, so check it while idle
+    StoreEraseOffset = 0;
+    uint8_t idx = 0;
+    StoreRecord_t record;
+    for (idx = STORE_RECORD_HEADER + 1; idx < STORE_RECORD_COUNT; idx++) {
+        uint8_t isValid = StoreReadRecord(StoreBank, idx, &record);
+        if (StoreIsErased((uint8_t *) &record, sizeof(StoreRecord_t)) == 1) {
+            break;
+        }
+        // Skip over torn records, but never write to them again
+        StoreNextRecord = idx + 1;
+        if (isValid == 1 &&
+            record.key < STORE_KEY_COUNT &&
+            (int16_t) (record.sequence - StoreSequence) > 0
+        ) {
+            StoreIndex[record.key] = idx;
+            StoreSequence = record.sequence;
+        }
+    }
+    LogDebug(
+        LOG_SOURCE_SYSTEM,
+        "Store: Bank %d, generation %u, %d records",
+        StoreBank,
+        StoreGeneration,
+        StoreNextRecord - 1
+    );
+    return 1;
+}
+
+/**
+ * StoreGet()
+ *     Description:
+ *         Read the latest value of a key
+ *     Params:
+ *         uint8_t key - The key
+ *         uint8_t *data - The buffer to read into
+ *         uint8_t size - The size of the buffer
+ *     Returns:
+ *         uint8_t - The number of bytes read, 0 if the key has no record
+ */
+uint8_t StoreGet(uint8_t key, uint8_t *data, uint8_t size)
+{
+    StoreRecord_t record;
+    if (key >= STORE_KEY_COUNT ||
+        StoreIndex[key] == STORE_RECORD_NONE ||
+        StoreReadRecord(StoreBank, StoreIndex[key], &record) == 0
+    ) {
+        return 0;
+    }
+    if (size > record.length) {
+        size = record.length;
+    }
+    memcpy(data, record.data, size);
+    return size;
+}
+
+/**
+ * StoreGetBank()
+ *     Description:
+ *         Get the active bank
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - The active bank
+ */
+uint8_t StoreGetBank()
+{
+    return StoreBank;
+}
+
+/**
+ * StoreGetRecordCount()
+ *     Description:
+ *         Get the number of records written to the active bank
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - The number of records, excluding the header
+ */
+uint8_t StoreGetRecordCount()
+{
+    return StoreNextRecord - 1;
+}
+
+/**
+ * StoreProcess()
+ *     Description:
+ *         Erase the stale bank one chunk at a time, so that compacting into
+ *         it later does not have to. Once it is erased and fewer than
+ *         STORE_COMPACT_RESERVE records are left in the active bank, compact
+ *         the store into it.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if the EEPROM was written, 0 otherwise
+ */
+uint8_t StoreProcess()
+{
+    while (StoreEraseOffset < STORE_BANK_SIZE) {
+        if (StoreEraseNext() == 1) {
+            return 1;
+        }
+    }
+    if (StoreNextRecord >= STORE_RECORD_COUNT - STORE_COMPACT_RESERVE) {
+        StoreCompact();
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * StoreSet()
+ *     Description:
+ *         Append a record with the new value of a key. StoreProcess()
+ *         compacts the store ahead of time, so the store is only compacted
+ *         here if the active bank filled up before that could happen.
+ *     Params:
+ *         uint8_t key - The key
+ *         const uint8_t *data - The value
+ *         uint8_t size - The size of the value
+ *     Returns:
+ *         void
+ */
+void StoreSet(uint8_t key, const uint8_t *data, uint8_t size)
+{
+    if (key >= STORE_KEY_COUNT) {
+        return;
+    }
+    if (size > STORE_RECORD_DATA_SIZE) {
+        size = STORE_RECORD_DATA_SIZE;
+    }
+    if (StoreNextRecord >= STORE_RECORD_COUNT) {
+        StoreCompact();
+    }
+    StoreRecord_t record;
+    memset(&record, STORE_ERASED, sizeof(StoreRecord_t));
+    record.key = key;
+    record.length = size;
+    record.sequence = ++StoreSequence;
+    memcpy(record.data, data, size);
+    StoreWriteRecord(StoreBank, StoreNextRecord, &record);
+    StoreIndex[key] = StoreNextRecord++;
+}
@@ -0,0 +1,70 @@
+/*
+ * File: store.h
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Log-structured record store for frequently changing values. Records
+ *     are appended to one of two EEPROM banks instead of being rewritten in
+ *     place, and the live records are compacted into the other bank while
+ *     idle once the active one is nearly full.
+ */
+#ifndef STORE_H
+#define STORE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "eeprom.h"
+#include "log.h"
+#include "timer.h"
+// EEPROM region reserved for the store, well clear of the configuration
+#define STORE_START_ADDRESS 0x1000
+#define STORE_BANK_SIZE 0x800
+#define STORE_BANK_COUNT 2
+// Records are page aligned, so that a record is written in one write cycle
+#define STORE_RECORD_SIZE 16
+#define STORE_RECORD_DATA_SIZE 11
+#define STORE_RECORD_COUNT (STORE_BANK_SIZE / STORE_RECORD_SIZE)
+// Compact while idle once this few records are left, so that StoreSet() only
+// has to compact when the bank fills up before the loop went idle
+#define STORE_COMPACT_RESERVE 8
+// The first record of a bank is its header
+#define STORE_RECORD_HEADER 0
+#define STORE_RECORD_NONE 0
+#define STORE_HEADER_MAGIC_MSB 0x42
+#define STORE_HEADER_MAGIC_LSB 0x53
+#define STORE_ERASED 0xFF
+#define STORE_ERASE_SIZE EEPROM_PAGE_SIZE_HW2
+#define STORE_CRC_POLYNOMIAL 0x07
+/* Record Keys */
+#define STORE_KEY_TRAPS 0x00
+#define STORE_KEY_BC127_BOOT_FAILURES 0x01
+#define STORE_KEY_LAST_CONNECTED_DEVICE 0x02
+#define STORE_KEY_COUNT 3
+#define STORE_KEY_HEADER 0xFE
+
+/**
+ * StoreRecord_t
+ *     Description:
+ *         A record as it is laid out in the EEPROM
+ *     Fields:
+ *         key - The record key, or STORE_KEY_HEADER for the bank header
+ *         length - The number of bytes of data
+ *         sequence - Incremented for every record written to a bank. For
+ *             the header it holds the generation of the bank.
+ *         data - The record data
+ *         crc - The CRC8 of all other fields
+ */
+typedef struct StoreRecord_t {
+    uint8_t key;
+    uint8_t length;
+    uint16_t sequence;
+    uint8_t data[STORE_RECORD_DATA_SIZE];
+    uint8_t crc;
+} StoreRecord_t;
+
+uint8_t StoreInit();
+uint8_t StoreGet(uint8_t, uint8_t *, uint8_t);
+uint8_t StoreGetBank();
+uint8_t StoreGetRecordCount();
+uint8_t StoreProcess();
+void StoreSet(uint8_t, const uint8_t *, uint8_t);
+#endif /* STORE_H */
@@ -9,6 +9,63 @@
 volatile uint32_t TimerCurrentMillis = 0;
 volatile TimerScheduledTask_t TimerRegisteredTasks[TIMER_TASKS_MAX];
 uint8_t TimerRegisteredTasksCount = 0;
+static uint32_t TimerOverrunLogTimestamp = 0;
+static TimerIdleStats_t TimerIdleStats;
+static uint8_t TimerNextTaskIndex = 0;
+static uint32_t TimerProcessDeferrals = 0;
+
+/**
+ * TimerRunScheduledTask()
+ *     Description:
+ *         Execute the given task and account for how late it started, how long
+ *         it ran and whether it exceeded its budget. Overruns are logged at
+ *         most once per TIMER_TASK_OVERRUN_LOG_INTERVAL.
+ *     Params:
+ *         volatile TimerScheduledTask_t *t - The task to execute
+ *     Returns:
+ *         void
+ */
+static void TimerRunScheduledTask(volatile TimerScheduledTask_t *t)
+{
+    uint16_t late = 0;
+    if (t->ticks > t->interval) {
+        late = t->ticks - t->interval;
+    }
+    uint32_t start = TimerGetMicroseconds();
+    t->task(t->context);
+    uint32_t runTime = TimerGetMicroseconds() - start;
+    // The task may have unregistered itself
+    if (t->task == 0) {
+        return;
+    }
+    t->stats.runCount++;
+    t->stats.runTimeTotal += runTime;
+    if (runTime > t->stats.runTimeMax) {
+        if (runTime > 0xFFFF) {
+            t->stats.runTimeMax = 0xFFFF;
+        } else {
+            t->stats.runTimeMax = runTime;
+        }
+    }
+    if (late > t->stats.lateMax) {
+        t->stats.lateMax = late;
+    }
+    if (t->budget != TIMER_TASK_BUDGET_DISABLED && runTime > t->budget) {
+        t->stats.overruns++;
+        uint32_t now = TimerGetMillis();
+        if (TimerOverrunLogTimestamp == 0 ||
+            now - TimerOverrunLogTimestamp >= TIMER_TASK_OVERRUN_LOG_INTERVAL
+        ) {
+            TimerOverrunLogTimestamp = now;
+            LogWarning(
+                "Timer: %s ran for %lu us (Budget: %u us)",
+                t->name,
+                runTime,
+                t->budget
+            );
+        }
+    }
+}
 
 /**
  * TimerInit()
@@ -22,7 +79,8 @@ uint8_t TimerRegisteredTasksCount = 0;
 void TimerInit()
 {
     T1CON = 0;
-    T1CON = TIMER_ON | STOP_TIMER_IN_IDLE_MODE | TIMER_SOURCE_INTERNAL | GATED_TIME_DISABLED | TIMER_16BIT_MODE | CLOCK_DIVIDER;
+    // Keep the timer running in Idle mode, it is what wakes the main loop
+    T1CON = TIMER_ON | TIMER_SOURCE_INTERNAL | GATED_TIME_DISABLED | TIMER_16BIT_MODE | CLOCK_DIVIDER;
     PR1 = PR1_SETTING;
     SetTIMERIP(TIMER_INDEX, TIMER_INTERRUPT_PRIORITY);
     SetTIMERIF(TIMER_INDEX, 0);
@@ -54,7 +112,9 @@ void TimerDelayMicroseconds(uint16_t delay)
 /**
  * TimerGetMillis()
  *     Description:
- *         Return the number of elapsed milliseconds since boot
+ *         Return the number of elapsed milliseconds since boot. Callers must
+ *         run at or below the Timer1 interrupt priority, like
+ *         TimerGetMicroseconds().
  *     Params:
  *         None
  *     Returns:
@@ -62,13 +122,54 @@ void TimerDelayMicroseconds(uint16_t delay)
  */
 uint32_t TimerGetMillis()
 {
-    return (uint32_t) TimerCurrentMillis;
+    uint32_t millis;
+    // The 32-bit counter is read as two words, so read it again if the ISR
+    // updated it in between
+    do {
+        millis = TimerCurrentMillis;
+    } while (millis != TimerCurrentMillis);
+    return millis;
+}
+
+/**
+ * TimerGetMicroseconds()
+ *     Description:
+ *         Return the number of elapsed microseconds since boot. The value is
+ *         derived from the millisecond counter and the running Timer1 count,
+ *         so it is free-running without needing another timer. It wraps
+ *         every ~71 minutes, so only use it to measure intervals.
+ *         Callers must run at or below the Timer1 interrupt priority. An ISR
+ *         that preempts the Timer1 ISR can see a half updated counter.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint32_t - The microseconds since boot
+ */
+uint32_t TimerGetMicroseconds()
+{
+    uint32_t millis;
+    uint16_t count;
+    uint8_t pendingTick;
+    do {
+        millis = TimerCurrentMillis;
+        count = TMR1;
+        // The period elapsed, but the ISR has not been able to run yet
+        pendingTick = 0;
+        if (IFS0bits.T1IF == 1 && count < (PR1_SETTING / 2)) {
+            pendingTick = 1;
+        }
+    } while (millis != TimerCurrentMillis);
+    millis += pendingTick;
+    return (millis * 1000) + (count / TIMER_TICKS_PER_MICROSECOND);
 }
 
 /**
  * TimerProcessScheduledTasks()
  *     Description:
- *         Run through the scheduled tasks and run any that are due.
+ *         Run through the scheduled tasks and run any that are due. Once
+ *         TIMER_PROCESS_BUDGET has been spent, the remaining tasks are carried
+ *         over to the next call, which starts where this one stopped so that
+ *         no task can be starved by the ones registered before it.
  *     Params:
  *         void
  *     Returns:
@@ -76,39 +177,67 @@ uint32_t TimerGetMillis()
  */
 void TimerProcessScheduledTasks()
 {
-    uint8_t idx;
-    for (idx = 0; idx < TimerRegisteredTasksCount; idx++) {
+    uint32_t start = TimerGetMicroseconds();
+    uint8_t idx = TimerNextTaskIndex;
+    uint8_t count;
+    for (count = 0; count < TimerRegisteredTasksCount; count++) {
+        if (idx >= TimerRegisteredTasksCount) {
+            idx = 0;
+        }
         volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[idx];
+        idx++;
         if (t->ticks >= t->interval && t->task != 0 && t->interval > 0) {
-            t->task(t->context);
+            TraceSetTask(idx - 1);
+            TimerRunScheduledTask(t);
+            TraceSetTask(TRACE_TASK_NONE);
             t->ticks = 0;
+            if (TimerGetMicroseconds() - start >= TIMER_PROCESS_BUDGET &&
+                count + 1 < TimerRegisteredTasksCount
+            ) {
+                TimerNextTaskIndex = idx;
+                TimerProcessDeferrals++;
+                return;
+            }
         }
     }
 }
 
 /**
- * TimerRegisterScheduledTask()
+ * TimerRegisterScheduledTaskNamed()
  *     Description:
  *         Register a function to be called at a given interval with the given
- *         context
+ *         context. TimerRegisterScheduledTask() wraps this and names the task
+ *         after the function it was given.
  *     Params:
  *         void *task - A pointer to the function to call
  *         void *ctx - A pointer to the context for which to pass to the function
  *         uint16_t interval - The number of milliseconds to elapse before calling
+ *         const char *name - A short name for the task
  *     Returns:
  *         uint8_t - The index of the scheduled task in the tasks array
  */
-uint8_t TimerRegisterScheduledTask(void *task, void *ctx, uint16_t interval)
-{
+uint8_t TimerRegisterScheduledTaskNamed(
+    void *task,
+    void *ctx,
+    uint16_t interval,
+    const char *name
+) {
     if (TimerRegisteredTasksCount == TIMER_TASKS_MAX) {
         LogError("FAILED TO REGISTER TIMER -- Allocations Full");
         return 0;
     }
+    // Drop the address-of operator that comes along with the function name
+    if (name[0] == '&') {
+        name++;
+    }
     TimerScheduledTask_t scheduledTask;
+    memset(&scheduledTask, 0, sizeof(TimerScheduledTask_t));
     scheduledTask.task = task;
     scheduledTask.context = ctx;
     scheduledTask.ticks = 0;
     scheduledTask.interval = interval;
+    scheduledTask.name = name;
+    scheduledTask.budget = TIMER_TASK_BUDGET_DEFAULT;
     TimerRegisteredTasks[TimerRegisteredTasksCount++] = scheduledTask;
     return TimerRegisteredTasksCount - 1;
 }
@@ -201,12 +330,177 @@ void TimerTriggerScheduledTask(uint8_t taskId)
     if (t->task != 0) {
         // Prevent it from executing immediately
         t->ticks = 0;
-        t->task(t->context);
+        TimerRunScheduledTask(t);
         // Reset the ticks so it runs exactly `interval` times before firing
         t->ticks = 0;
     }
 }
 
+/**
+ * TimerGetNextTaskDeadline()
+ *     Description:
+ *         Get the number of milliseconds until the next scheduled task is due
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint16_t - The milliseconds until the next task is due, or
+ *             TIMER_NO_DEADLINE if no task is scheduled
+ */
+uint16_t TimerGetNextTaskDeadline()
+{
+    uint16_t deadline = TIMER_NO_DEADLINE;
+    uint8_t idx;
+    for (idx = 0; idx < TimerRegisteredTasksCount; idx++) {
+        volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[idx];
+        if (t->task != 0 && t->interval > 0) {
+            uint16_t ticks = t->ticks;
+            if (ticks >= t->interval) {
+                return 0;
+            }
+            if (t->interval - ticks < deadline) {
+                deadline = t->interval - ticks;
+            }
+        }
+    }
+    return deadline;
+}
+
+/**
+ * TimerIdle()
+ *     Description:
+ *         Put the CPU into Idle mode until the next interrupt. Timer1 keeps
+ *         running in Idle, so we wake within a millisecond at the latest.
+ *         The UART RX interrupts wake us as soon as data arrives.
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void TimerIdle()
+{
+    uint32_t start = TimerGetMicroseconds();
+    Idle();
+    uint32_t residency = TimerGetMicroseconds() - start;
+    TimerIdleStats.entries++;
+    residency += TimerIdleStats.residencyRemainder;
+    TimerIdleStats.residency += residency / 1000;
+    TimerIdleStats.residencyRemainder = residency % 1000;
+}
+
+/**
+ * TimerGetIdleStats()
+ *     Description:
+ *         Get the Idle mode accounting
+ *     Params:
+ *         None
+ *     Returns:
+ *         TimerIdleStats_t * - The Idle mode stats
+ */
+TimerIdleStats_t *TimerGetIdleStats()
+{
+    return &TimerIdleStats;
+}
+
+/**
+ * TimerResetIdleStats()
+ *     Description:
+ *         Clear the Idle mode accounting and restart the period it covers
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void TimerResetIdleStats()
+{
+    memset(&TimerIdleStats, 0, sizeof(TimerIdleStats_t));
+    TimerIdleStats.resetTimestamp = TimerGetMillis();
+}
+
+/**
+ * TimerGetScheduledTask()
+ *     Description:
+ *         Get the scheduled task at the given index so its name and runtime
+ *         stats can be inspected
+ *     Params:
+ *         uint8_t taskId - The index of the scheduled task in the tasks array
+ *     Returns:
+ *         volatile TimerScheduledTask_t * - The task or 0 if the index is invalid
+ */
+volatile TimerScheduledTask_t *TimerGetScheduledTask(uint8_t taskId)
+{
+    if (taskId >= TimerRegisteredTasksCount) {
+        return 0;
+    }
+    return &TimerRegisteredTasks[taskId];
+}
+
+/**
+ * TimerGetScheduledTaskCount()
+ *     Description:
+ *         Get the number of task slots that have been allocated
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - The number of allocated task slots
+ */
+uint8_t TimerGetScheduledTaskCount()
+{
+    return TimerRegisteredTasksCount;
+}
+
+/**
+ * TimerGetProcessDeferrals()
+ *     Description:
+ *         Get the number of times the scheduled task budget ran out and the
+ *         remaining tasks were carried over to the next pass
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint32_t - The number of deferred passes
+ */
+uint32_t TimerGetProcessDeferrals()
+{
+    return TimerProcessDeferrals;
+}
+
+/**
+ * TimerResetTaskStats()
+ *     Description:
+ *         Clear the runtime stats for all scheduled tasks
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void TimerResetTaskStats()
+{
+    uint8_t idx;
+    for (idx = 0; idx < TimerRegisteredTasksCount; idx++) {
+        volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[idx];
+        memset((void *)&t->stats, 0, sizeof(TimerTaskStats_t));
+    }
+    TimerProcessDeferrals = 0;
+}
+
+/**
+ * TimerSetTaskBudget()
+ *     Description:
+ *         Change the execution budget of a task. A budget of
+ *         TIMER_TASK_BUDGET_DISABLED disables overrun tracking.
+ *     Params:
+ *         uint8_t taskId - The index of the scheduled task in the tasks array
+ *         uint16_t budget - The microseconds the task may run for
+ *     Returns:
+ *         void
+ */
+void TimerSetTaskBudget(uint8_t taskId, uint16_t budget)
+{
+    volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
+    if (t->task != 0) {
+        t->budget = budget;
+    }
+}
+
 /**
  * T1Interrupt
  *     Description:
@@ -21,11 +21,42 @@
 #define TIMER_TASKS_MAX 32
 #define TIMER_INDEX 0
 #define TIMER_TASK_DISABLED 0
+#define TIMER_TICKS_PER_MICROSECOND (SYS_CLOCK / 1000000)
+// Execution budget for a single task run, in microseconds
+#define TIMER_TASK_BUDGET_DEFAULT 2000
+#define TIMER_TASK_BUDGET_DISABLED 0
+// Only log one budget overrun within this many milliseconds
+#define TIMER_TASK_OVERRUN_LOG_INTERVAL 1000
+// Time allowed for a single pass over the scheduled tasks, in microseconds
+#define TIMER_PROCESS_BUDGET 4000
+// Only idle if no task is due within this many milliseconds
+#define TIMER_IDLE_MIN_DEADLINE 2
+#define TIMER_NO_DEADLINE 0xFFFF
 #include <stdint.h>
 #include <string.h>
 #include <xc.h>
 #include "log.h"
 #include "sfr_setters.h"
+#include "trace.h"
+/**
+ * TimerTaskStats_t
+ *     Description:
+ *         Runtime accounting for a scheduled task
+ *     Fields:
+ *         runCount - The number of times the task has been executed
+ *         runTimeTotal - The cumulative execution time (microseconds)
+ *         runTimeMax - The longest single execution (microseconds)
+ *         lateMax - The most the task started after its interval (milliseconds)
+ *         overruns - The number of executions that exceeded the budget
+ */
+typedef struct TimerTaskStats_t {
+    uint32_t runCount;
+    uint32_t runTimeTotal;
+    uint16_t runTimeMax;
+    uint16_t lateMax;
+    uint16_t overruns;
+} TimerTaskStats_t;
+
 /**
  * TimerScheduledTask_t
  *     Description:
@@ -35,22 +66,58 @@
  *         *context - A pointer to the context to pass to the function pointer
  *         interval - The number of ticks to let pass before executing (milliseconds)
  *         ticks - The amount of ticks that have passed since the last call
+ *         *name - A short name for the task, used in the stats output
+ *         budget - The execution time allowed per run (microseconds)
+ *         stats - The runtime accounting for this task
  */
 typedef struct TimerScheduledTask_t {
     void (*task)(void *);
     void *context;
     uint16_t interval;
     uint16_t ticks;
+    const char *name;
+    uint16_t budget;
+    TimerTaskStats_t stats;
 } TimerScheduledTask_t;
 
+/**
+ * TimerIdleStats_t
+ *     Description:
+ *         Accounting for the time the CPU has spent in Idle mode
+ *     Fields:
+ *         entries - The number of times Idle mode was entered
+ *         residency - The total time spent in Idle mode (milliseconds)
+ *         residencyRemainder - Sub-millisecond residency not yet counted (microseconds)
+ *         resetTimestamp - The uptime at which the stats were last cleared (milliseconds)
+ */
+typedef struct TimerIdleStats_t {
+    uint32_t entries;
+    uint32_t residency;
+    uint16_t residencyRemainder;
+    uint32_t resetTimestamp;
+} TimerIdleStats_t;
+
 void TimerInit();
 void TimerDelayMicroseconds(uint16_t);
 uint32_t TimerGetMillis();
+uint32_t TimerGetMicroseconds();
 void TimerProcessScheduledTasks();
-uint8_t TimerRegisterScheduledTask(void *, void *, uint16_t);
+uint8_t TimerRegisterScheduledTaskNamed(void *, void *, uint16_t, const char *);
+// Name every task after the function it runs
+#define TimerRegisterScheduledTask(task, ctx, interval) \
+    TimerRegisterScheduledTaskNamed(task, ctx, interval, #task)
+volatile TimerScheduledTask_t *TimerGetScheduledTask(uint8_t);
+uint8_t TimerGetScheduledTaskCount();
+uint32_t TimerGetProcessDeferrals();
+void TimerResetTaskStats();
+void TimerSetTaskBudget(uint8_t, uint16_t);
 uint8_t TimerUnregisterScheduledTask(void *);
 void TimerUnregisterScheduledTaskById(uint8_t);
 void TimerResetScheduledTask(uint8_t);
 void TimerSetTaskInterval(uint8_t, uint16_t);
 void TimerTriggerScheduledTask(uint8_t);
+uint16_t TimerGetNextTaskDeadline();
+void TimerIdle();
+TimerIdleStats_t *TimerGetIdleStats();
+void TimerResetIdleStats();
 #endif /* TIMER_H */
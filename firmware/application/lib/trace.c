@@ -0,0 +1,201 @@
+/*
+ * File: trace.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Keep a trace of the most recent events in RAM that is not cleared on
+ *     reset, so that the context of a trap can be reported on the next boot
+ */
+#include "trace.h"
+// Persistent data is not zeroed by the C runtime on start-up
+static Trace_t TraceBuffer __attribute__((persistent));
+static const char *TraceEventNames[] = {"", "IBUS", "BT"};
+
+/**
+ * TraceCalculateCRC()
+ *     Description:
+ *         Calculate the CRC16 (CCITT) of the trace, excluding the magic word
+ *         and the CRC itself
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint16_t - The CRC
+ */
+static uint16_t TraceCalculateCRC()
+{
+    uint8_t *data = (uint8_t *) &TraceBuffer.timestamp;
+    uint16_t length = sizeof(Trace_t) - offsetof(Trace_t, timestamp);
+    uint16_t crc = 0xFFFF;
+    uint16_t idx = 0;
+    for (idx = 0; idx < length; idx++) {
+        crc ^= (uint16_t) data[idx] << 8;
+        uint8_t bit = 0;
+        for (bit = 0; bit < 8; bit++) {
+            if ((crc & 0x8000) != 0) {
+                crc = (crc << 1) ^ 0x1021;
+            } else {
+                crc = crc << 1;
+            }
+        }
+    }
+    return crc;
+}
+
+/**
+ * TracePrint()
+ *     Description:
+ *         Print the trace state and its events, oldest first
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+static void TracePrint()
+{
+    LogRaw(
+        "    Stage: %d, Task: %d, SP: %04X, Uptime: %lu ms\r\n",
+        TraceBuffer.stage,
+        TraceBuffer.task,
+        TraceBuffer.stackPointer,
+        TraceBuffer.timestamp
+    );
+    if (TraceBuffer.task != TRACE_TASK_NONE) {
+        volatile TimerScheduledTask_t *task = TimerGetScheduledTask(
+            TraceBuffer.task
+        );
+        if (task != 0 && task->name != 0) {
+            LogRaw("    Task Name: %s\r\n", task->name);
+        }
+    }
+    uint8_t count = 0;
+    uint8_t idx = TraceBuffer.eventIdx;
+    for (count = 0; count < TRACE_EVENT_COUNT; count++) {
+        TraceEvent_t *event = &TraceBuffer.events[idx];
+        idx = (idx + 1) % TRACE_EVENT_COUNT;
+        if (event->type == 0 || event->type > TRACE_EVENT_BT_RX) {
+            continue;
+        }
+        LogRaw(
+            "    [%u] %s[%d]:",
+            event->timestamp,
+            TraceEventNames[event->type],
+            event->length
+        );
+        uint8_t i = 0;
+        for (i = 0; i < event->length && i < TRACE_EVENT_DATA_SIZE; i++) {
+            LogRaw(" %02X", event->data[i]);
+        }
+        LogRaw("\r\n");
+    }
+}
+
+/**
+ * TraceInit()
+ *     Description:
+ *         Report the trace if the last reset was caused by a trap, then
+ *         clear it and start recording again
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void TraceInit()
+{
+    if (TraceBuffer.magic == TRACE_MAGIC &&
+        TraceBuffer.crc == TraceCalculateCRC()
+    ) {
+        LogRaw("Post-mortem trace for trap %02X:\r\n", TraceBuffer.trap);
+        TracePrint();
+    }
+    memset(&TraceBuffer, 0, sizeof(Trace_t));
+    TraceBuffer.task = TRACE_TASK_NONE;
+}
+
+/**
+ * TraceDump()
+ *     Description:
+ *         Print the events recorded since boot
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void TraceDump()
+{
+    TraceBuffer.timestamp = TimerGetMillis();
+    TraceBuffer.stackPointer = WREG15;
+    LogRaw("Trace:\r\n");
+    TracePrint();
+}
+
+/**
+ * TraceEvent()
+ *     Description:
+ *         Record an event in the trace. Only the first
+ *         TRACE_EVENT_DATA_SIZE bytes of the data are kept. This must not be
+ *         called from an ISR.
+ *     Params:
+ *         uint8_t type - The event type
+ *         uint8_t *data - The event data
+ *         uint16_t length - The length of the event data
+ *     Returns:
+ *         void
+ */
+void TraceEvent(uint8_t type, uint8_t *data, uint16_t length)
+{
+    TraceEvent_t *event = &TraceBuffer.events[TraceBuffer.eventIdx];
+    event->timestamp = (uint16_t) TimerGetMillis();
+    event->type = type;
+    event->length = length > 0xFF ? 0xFF : length;
+    if (length > TRACE_EVENT_DATA_SIZE) {
+        length = TRACE_EVENT_DATA_SIZE;
+    }
+    memcpy(event->data, data, length);
+    TraceBuffer.eventIdx = (TraceBuffer.eventIdx + 1) % TRACE_EVENT_COUNT;
+}
+
+/**
+ * TraceFreeze()
+ *     Description:
+ *         Record the trap context and seal the trace with the magic word and
+ *         CRC so that it is reported on the next boot
+ *     Params:
+ *         uint8_t trap - The trap type
+ *     Returns:
+ *         void
+ */
+void TraceFreeze(uint8_t trap)
+{
+    TraceBuffer.stackPointer = WREG15;
+    TraceBuffer.timestamp = TimerGetMillis();
+    TraceBuffer.trap = trap;
+    TraceBuffer.crc = TraceCalculateCRC();
+    TraceBuffer.magic = TRACE_MAGIC;
+}
+
+/**
+ * TraceSetStage()
+ *     Description:
+ *         Record the main loop stage that is about to run
+ *     Params:
+ *         uint8_t stage - The stage
+ *     Returns:
+ *         void
+ */
+void TraceSetStage(uint8_t stage)
+{
+    TraceBuffer.stage = stage;
+}
+
+/**
+ * TraceSetTask()
+ *     Description:
+ *         Record the scheduled task that is about to run
+ *     Params:
+ *         uint8_t task - The task index, TRACE_TASK_NONE once it returns
+ *     Returns:
+ *         void
+ */
+void TraceSetTask(uint8_t task)
+{
+    TraceBuffer.task = task;
+}
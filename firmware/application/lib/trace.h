@@ -0,0 +1,80 @@
+/*
+ * File: trace.h
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Keep a trace of the most recent events in RAM that is not cleared on
+ *     reset, so that the context of a trap can be reported on the next boot
+ */
+#ifndef TRACE_H
+#define TRACE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <xc.h>
+#include "log.h"
+#include "timer.h"
+#define TRACE_MAGIC 0x7AC3
+#define TRACE_EVENT_COUNT 32
+#define TRACE_EVENT_DATA_SIZE 6
+#define TRACE_EVENT_IBUS_RX 1
+#define TRACE_EVENT_BT_RX 2
+#define TRACE_STAGE_IBUS 1
+#define TRACE_STAGE_BT 2
+#define TRACE_STAGE_TASKS 3
+#define TRACE_STAGE_CLI 4
+#define TRACE_STAGE_IDLE 5
+#define TRACE_STAGE_EEPROM 6
+#define TRACE_TASK_NONE 0xFF
+
+/**
+ * TraceEvent_t
+ *     Description:
+ *         A single trace entry
+ *     Fields:
+ *         uint16_t timestamp - The lower 16 bits of the millisecond timer
+ *         uint8_t type - The event type
+ *         uint8_t length - The full length of the recorded data
+ *         uint8_t data - The first TRACE_EVENT_DATA_SIZE bytes of the data
+ */
+typedef struct TraceEvent_t {
+    uint16_t timestamp;
+    uint8_t type;
+    uint8_t length;
+    uint8_t data[TRACE_EVENT_DATA_SIZE];
+} TraceEvent_t;
+
+/**
+ * Trace_t
+ *     Description:
+ *         The trace itself. The magic and CRC are only set when a trap freezes
+ *         the trace, so a trace is only reported after a trap.
+ *     Fields:
+ *         uint16_t magic - TRACE_MAGIC if the trace was frozen by a trap
+ *         uint16_t crc - CRC16 of everything after this field
+ *         uint32_t timestamp - Milliseconds since boot at the time of the trap
+ *         uint16_t stackPointer - The stack pointer at the time of the trap
+ *         uint8_t trap - The trap type, see CONFIG_TRAP_*
+ *         uint8_t stage - The main loop stage, see TRACE_STAGE_*
+ *         uint8_t task - The index of the scheduled task being run
+ *         uint8_t eventIdx - The index of the next event to write
+ *         TraceEvent_t events - The event ring buffer
+ */
+typedef struct Trace_t {
+    uint16_t magic;
+    uint16_t crc;
+    uint32_t timestamp;
+    uint16_t stackPointer;
+    uint8_t trap;
+    uint8_t stage;
+    uint8_t task;
+    uint8_t eventIdx;
+    TraceEvent_t events[TRACE_EVENT_COUNT];
+} Trace_t;
+
+void TraceInit();
+void TraceDump();
+void TraceEvent(uint8_t, uint8_t *, uint16_t);
+void TraceFreeze(uint8_t);
+void TraceSetStage(uint8_t);
+void TraceSetTask(uint8_t);
+#endif /* TRACE_H */
@@ -23,9 +23,11 @@ UART_t UARTInit(
 ) {
     UART_t uart;
     uart.rxQueue = CharQueueInit();
+    uart.txQueue = 0;
     uart.moduleIndex = uartModule - 1;
     uart.rxError = 0;
     uart.txPin = txPin;
+    uart.txPriority = txPriority;
     // Unlock the reprogrammable pin register
     __builtin_write_OSCCONL(OSCCON & 0xBF);
     // Set the RX Pin and register. The register comes from the PIC24FJ header
@@ -53,7 +55,7 @@ UART_t UARTInit(
     __builtin_write_OSCCONL(OSCCON & 0x40);
     //Set the BAUD Rate
     uart.registers->uxbrg = baudRate;
-    // Disable the TX ISR, since we handle it manually and Enable the RX ISR
+    // Disable the TX ISR until a TX queue is attached and Enable the RX ISR
     SetUARTTXIE(uart.moduleIndex, 0);
     SetUARTRXIE(uart.moduleIndex, 1);
     // Set the ISR Flag to disabled for RX (as it should be when the hardware
@@ -141,11 +143,126 @@ void UARTDestroy(uint8_t uartModule) {
     }
 }
 
+/**
+ * UARTFlush()
+ *     Description:
+ *         Synchronously send everything in the TX queue and wait for the
+ *         transmitter to go idle. This does not rely on the TX ISR, so it
+ *         can be used when interrupts cannot run, like in trap handlers.
+ *     Params:
+ *         UART_t *uart - The UART object
+ *     Returns:
+ *         void
+ */
+void UARTFlush(UART_t *uart)
+{
+    if (uart->txQueue == 0) {
+        return;
+    }
+    SetUARTTXIE(uart->moduleIndex, 0);
+    while (CharQueueGetSize(uart->txQueue) > 0) {
+        // Wait for room in the TX buffer
+        while ((uart->registers->uxsta & (1 << 9)) != 0);
+        uart->registers->uxtxreg = CharQueueNext(uart->txQueue);
+    }
+    // Wait for the shift register to empty
+    while ((uart->registers->uxsta & (1 << 8)) == 0);
+}
+
 UART_t * UARTGetModuleHandler(uint8_t moduleIndex)
 {
     return UARTModules[moduleIndex - 1];
 }
 
+/**
+ * UARTTXInterruptHandler()
+ *     Description:
+ *         Move data from the TX queue into the hardware TX buffer while it has
+ *         room. Disable the TX ISR once the queue is empty.
+ *     Params:
+ *         uint8_t moduleIndex - The UART module index
+ *     Returns:
+ *         void
+ */
+static void UARTTXInterruptHandler(uint8_t moduleIndex)
+{
+    SetUARTTXIF(moduleIndex, 0);
+    UART_t *uart = UARTModules[moduleIndex];
+    if (uart == 0 || uart->txQueue == 0) {
+        SetUARTTXIE(moduleIndex, 0);
+        return;
+    }
+    while ((uart->registers->uxsta & (1 << 9)) == 0 &&
+           CharQueueGetSize(uart->txQueue) > 0
+    ) {
+        uart->registers->uxtxreg = CharQueueNext(uart->txQueue);
+    }
+    if (CharQueueGetSize(uart->txQueue) == 0) {
+        SetUARTTXIE(moduleIndex, 0);
+    }
+}
+
+/**
+ * UARTTXStart()
+ *     Description:
+ *         Raise the TX interrupt so the ISR starts draining the TX queue
+ *     Params:
+ *         UART_t *uart - The UART object
+ *     Returns:
+ *         void
+ */
+static void UARTTXStart(UART_t *uart)
+{
+    SetUARTTXIF(uart->moduleIndex, 1);
+    SetUARTTXIE(uart->moduleIndex, 1);
+}
+
+/**
+ * UARTTXCanInterrupt()
+ *     Description:
+ *         Check if the TX ISR is able to preempt the caller. It cannot while
+ *         the CPU runs at or above its priority, like from an ISR of the same
+ *         or a higher priority, or from a trap.
+ *     Params:
+ *         UART_t *uart - The UART object
+ *     Returns:
+ *         uint8_t - 1 if the TX ISR can run, 0 otherwise
+ */
+static uint8_t UARTTXCanInterrupt(UART_t *uart)
+{
+    if (CORCONbits.IPL3 == 1 || SRbits.IPL >= uart->txPriority) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * UARTTXQueueChar()
+ *     Description:
+ *         Add a byte to the TX queue, waiting for the TX ISR to make room if
+ *         the queue is full. If the TX ISR cannot run at the current
+ *         priority, the oldest byte is sent synchronously to make room.
+ *     Params:
+ *         UART_t *uart - The UART object
+ *         uint8_t data - The byte to send
+ *     Returns:
+ *         void
+ */
+static void UARTTXQueueChar(UART_t *uart, uint8_t data)
+{
+    if (CharQueueGetSize(uart->txQueue) >= UART_TX_QUEUE_CAPACITY) {
+        if (UARTTXCanInterrupt(uart) == 1) {
+            UARTTXStart(uart);
+            while (CharQueueGetSize(uart->txQueue) >= UART_TX_QUEUE_CAPACITY);
+        } else {
+            // Wait for room in the TX buffer
+            while ((uart->registers->uxsta & (1 << 9)) != 0);
+            uart->registers->uxtxreg = CharQueueNext(uart->txQueue);
+        }
+    }
+    CharQueueAdd(uart->txQueue, data);
+}
+
 static uint8_t UARTRXInterruptHandler(uint8_t moduleIndex)
 {
     UART_t *uart = UARTModules[moduleIndex];
@@ -207,26 +324,17 @@ static uint8_t UARTRXInterruptHandler(uint8_t moduleIndex)
 void UARTReportErrors(UART_t *uart)
 {
     if (uart->rxError != 0) {
-        long long unsigned int ts = (long long unsigned int) TimerGetMillis();
+        long long unsigned int ts = LogGetTimestamp();
         LogRawDebug(
             LOG_SOURCE_SYSTEM,
-            "[%llu] ERROR: UART[%d]: ",
+            "[%llu] ERROR: UART[%d]: %s%s%s%s\r\n",
             ts,
-            uart->moduleIndex + 1
+            uart->moduleIndex + 1,
+            (uart->rxError & UART_ERR_GERR) != 0 ? "GERR " : "",
+            (uart->rxError & UART_ERR_OERR) != 0 ? "OERR " : "",
+            (uart->rxError & UART_ERR_FERR) != 0 ? "FERR " : "",
+            (uart->rxError & UART_ERR_PERR) != 0 ? "PERR " : ""
         );
-        if ((uart->rxError & UART_ERR_GERR) != 0) {
-            LogRawDebug(LOG_SOURCE_SYSTEM, "GERR ");
-        }
-        if ((uart->rxError & UART_ERR_OERR) != 0) {
-            LogRawDebug(LOG_SOURCE_SYSTEM, "OERR ");
-        }
-        if ((uart->rxError & UART_ERR_FERR) != 0) {
-            LogRawDebug(LOG_SOURCE_SYSTEM, "FERR ");
-        }
-        if ((uart->rxError & UART_ERR_PERR) != 0) {
-            LogRawDebug(LOG_SOURCE_SYSTEM, "PERR ");
-        }
-        LogRawDebug(LOG_SOURCE_SYSTEM, "\r\n");
         uart->rxError = 0;
     }
 }
@@ -238,6 +346,11 @@ void UARTRXQueueReset(UART_t *uart)
 
 void UARTSendChar(UART_t *uart, unsigned char data)
 {
+    if (uart->txQueue != 0) {
+        UARTTXQueueChar(uart, data);
+        UARTTXStart(uart);
+        return;
+    }
     uart->registers->uxtxreg = data;
     // Wait for the data to leave the tx buffer
     while ((uart->registers->uxsta & (1 << 9)) != 0);
@@ -246,6 +359,13 @@ void UARTSendChar(UART_t *uart, unsigned char data)
 void UARTSendData(UART_t *uart, unsigned char *data, uint16_t length)
 {
     uint16_t i;
+    if (uart->txQueue != 0) {
+        for (i = 0; i < length; i++) {
+            UARTTXQueueChar(uart, data[i]);
+        }
+        UARTTXStart(uart);
+        return;
+    }
     for (i = 0; i < length; i++) {
         uart->registers->uxtxreg = data[i];
         // Wait for the data to leave the tx buffer
@@ -261,11 +381,53 @@ void UARTSendString(UART_t *uart, char *data)
         char c = data[i];
         // Print only readable and newline characters
         if ((c >= 0x20 && c <= 0x7E) || c == 0x0D || c == 0x0A) {
-            uart->registers->uxtxreg = c;
-            // Wait for the data to leave the tx buffer
-            while ((uart->registers->uxsta & (1 << 9)) != 0);
+            if (uart->txQueue != 0) {
+                UARTTXQueueChar(uart, c);
+            } else {
+                uart->registers->uxtxreg = c;
+                // Wait for the data to leave the tx buffer
+                while ((uart->registers->uxsta & (1 << 9)) != 0);
+            }
         }
     }
+    if (uart->txQueue != 0) {
+        UARTTXStart(uart);
+    }
+}
+
+/**
+ * UARTSetTXQueue()
+ *     Description:
+ *         Attach a queue that data will be sent from by the TX ISR, making
+ *         the send functions non-blocking until the queue fills. Passing 0
+ *         flushes and detaches the queue, making sends synchronous again.
+ *     Params:
+ *         UART_t *uart - The UART object
+ *         volatile CharQueue_t *queue - The queue to send from
+ *     Returns:
+ *         void
+ */
+void UARTSetTXQueue(UART_t *uart, volatile CharQueue_t *queue)
+{
+    UARTFlush(uart);
+    uart->txQueue = queue;
+}
+
+/**
+ * UARTGetTXQueueSpace()
+ *     Description:
+ *         Get the number of bytes that can be sent without blocking
+ *     Params:
+ *         UART_t *uart - The UART object
+ *     Returns:
+ *         uint16_t - The free space in the TX queue, or 0 if there is no queue
+ */
+uint16_t UARTGetTXQueueSpace(UART_t *uart)
+{
+    if (uart->txQueue == 0) {
+        return 0;
+    }
+    return UART_TX_QUEUE_CAPACITY - CharQueueGetSize(uart->txQueue);
 }
 
 /*
@@ -286,4 +448,24 @@ void __attribute__((__interrupt__, auto_psv)) _AltU3RXInterrupt()
 void __attribute__((__interrupt__, auto_psv)) _AltU4RXInterrupt()
 {
     UARTRXInterruptHandler(3);
-}
\ No newline at end of file
+}
+
+/*
+ * Define the TX interrupt handlers that drain the TX queues
+ */
+void __attribute__((__interrupt__, auto_psv)) _AltU1TXInterrupt()
+{
+    UARTTXInterruptHandler(0);
+}
+void __attribute__((__interrupt__, auto_psv)) _AltU2TXInterrupt()
+{
+    UARTTXInterruptHandler(1);
+}
+void __attribute__((__interrupt__, auto_psv)) _AltU3TXInterrupt()
+{
+    UARTTXInterruptHandler(2);
+}
+void __attribute__((__interrupt__, auto_psv)) _AltU4TXInterrupt()
+{
+    UARTTXInterruptHandler(3);
+}
@@ -23,17 +23,22 @@
 #define UART_PARITY_NONE 0
 #define UART_PARITY_EVEN 1
 #define UART_PARITY_ODD 2
+// One slot is lost to tell a full queue apart from an empty one
+#define UART_TX_QUEUE_CAPACITY (CHAR_QUEUE_SIZE - 1)
 
 /**
  * UART_t
  *     Description:
  *         This object defines helper functionality to allow us to read and
- *         write data from the UART module
+ *         write data from the UART module. If a TX queue is attached, data
+ *         is sent from the TX ISR rather than written out synchronously.
  */
 typedef struct UART_t {
     volatile CharQueue_t rxQueue;
+    volatile CharQueue_t *txQueue;
     uint8_t moduleIndex;
     uint8_t txPin;
+    uint8_t txPriority;
     volatile uint16_t rxError;
     volatile UART *registers;
 } UART_t;
@@ -41,10 +46,13 @@ typedef struct UART_t {
 UART_t UARTInit(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
 void UARTAddModuleHandler(UART_t *uart);
 void UARTDestroy(uint8_t);
+void UARTFlush(UART_t *);
 UART_t * UARTGetModuleHandler(uint8_t);
 void UARTRXQueueReset(UART_t *);
 void UARTReportErrors(UART_t *);
 void UARTSendChar(UART_t *, uint8_t);
 void UARTSendData(UART_t *, uint8_t *, uint16_t);
 void UARTSendString(UART_t *, char *);
+void UARTSetTXQueue(UART_t *, volatile CharQueue_t *);
+uint16_t UARTGetTXQueueSpace(UART_t *);
 #endif /* UART_H */
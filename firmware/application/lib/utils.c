@@ -122,6 +122,26 @@ uint8_t UtilsGetUnicodeByteLength(uint8_t byte)
     return bytesInChar;
 }
 
+/**
+ * UtilsHash()
+ *     Description:
+ *         Get the 32-bit FNV-1a hash of the given bytes
+ *     Params:
+ *         const char *data - The bytes to hash
+ *         uint16_t length - The number of bytes to hash
+ *     Returns:
+ *         uint32_t - The hash
+ */
+uint32_t UtilsHash(const char *data, uint16_t length)
+{
+    uint32_t hash = UTILS_HASH_OFFSET_BASIS;
+    uint16_t idx = 0;
+    for (idx = 0; idx < length; idx++) {
+        hash = (hash ^ (uint8_t) data[idx]) * UTILS_HASH_PRIME;
+    }
+    return hash;
+}
+
 /**
  * UtilsNormalizeText()
  *     Description:
@@ -136,6 +156,29 @@ uint8_t UtilsGetUnicodeByteLength(uint8_t byte)
  */
 void UtilsNormalizeText(char *string, const char *input, uint16_t max_len)
 {
+    UtilsNormalizeTextLength(string, input, strlen(input), max_len);
+}
+
+/**
+ * UtilsNormalizeTextLength()
+ *     Description:
+ *         Normalize the given number of bytes, like UtilsNormalizeText().
+ *         The input does not need to be terminated, so that text can be
+ *         normalized straight out of a frame buffer.
+ *     Params:
+ *         char *string - The subject
+ *         const char *input - The bytes to copy from
+ *         uint16_t strLength - The number of bytes to read from the input
+ *         uint16_t max_len - Max output buffer size
+ *     Returns:
+ *         void
+ */
+void UtilsNormalizeTextLength(
+    char *string,
+    const char *input,
+    uint16_t strLength,
+    uint16_t max_len
+) {
     uint16_t idx = 0;
     uint16_t strIdx = 0;
     uint32_t unicodeChar;
@@ -144,7 +187,6 @@ void UtilsNormalizeText(char *string, const char *input, uint16_t max_len)
     uint8_t transIdx;
     uint8_t transStrLength;
 
-    uint16_t strLength = strlen(input);
     uint8_t bytesInChar = 0;
     uint8_t language = ConfigGetSetting(CONFIG_SETTING_LANGUAGE);
 
@@ -155,7 +197,11 @@ void UtilsNormalizeText(char *string, const char *input, uint16_t max_len)
         uint8_t currentChar = (uint8_t) input[idx];
         unicodeChar = currentChar;
 
-        if (currentChar == '\\') {
+        if (currentChar == '\\' && idx + 2 >= strLength) {
+            // The escape sequence is cut off within its first hex byte
+            unicodeChar = 0;
+            idx = strLength;
+        } else if (currentChar == '\\') {
             unicodeChar = 0;
             char currentByteBuf[] = {input[idx + 1], input[idx + 2], '\0'};
             uint8_t currentByte = UtilsStrToHex(currentByteBuf);
@@ -156,6 +156,8 @@
 #define UTILS_CHAR_LEFT_SINGLE_QUOTATION_MARK 0xE28098
 #define UTILS_CHAR_RIGHT_SINGLE_QUOTATION_MARK 0xE28099
 #define UTILS_CHAR_HORIZONTAL_ELLIPSIS 0xE280A6
+#define UTILS_HASH_OFFSET_BASIS 0x811C9DC5
+#define UTILS_HASH_PRIME 0x01000193
 #define UTILS_MAX_RPOR_PIN 31
 #define UTILS_DISPLAY_TEXT_SIZE 255
 #define UTILS_PIN_TEL_MUTE 0
@@ -190,7 +192,9 @@ UtilsAbstractDisplayValue_t UtilsDisplayValueInit(char *, uint8_t);
 uint8_t UtilsGetBoardVersion();
 uint8_t UtilsGetMinByte(uint8_t *, uint8_t);
 uint8_t UtilsGetUnicodeByteLength(uint8_t);
+uint32_t UtilsHash(const char *, uint16_t);
 void UtilsNormalizeText(char *, const char *, uint16_t);
+void UtilsNormalizeTextLength(char *, const char *, uint16_t, uint16_t);
 void UtilsRemoveSubstring(char *, const char *);
 void UtilsReset();
 void UtilsSetRPORMode(uint8_t, uint16_t);
@@ -19,6 +19,7 @@
 #include "lib/ibus.h"
 #include "lib/pcm51xx.h"
 #include "lib/timer.h"
+#include "lib/trace.h"
 #include "lib/uart.h"
 #include "lib/utils.h"
 #include "lib/wm88xx.h"
@@ -113,11 +114,18 @@ int main(void)
     // All UART handler registrations need to be done at
     // this level to maintain a global scope
     UARTAddModuleHandler(&systemUart);
+    // Send log messages from the TX ISR so that logging does not block
+    LogInit();
     LogMessage("", "**** BlueBus ****");
 
     // Initialize low level modules
     EEPROMInit();
     TimerInit();
+    uint32_t configLoadStart = TimerGetMicroseconds();
+    ConfigInit();
+    uint32_t configLoadTime = TimerGetMicroseconds() - configLoadStart;
+    LogLoadSources();
+    LogInfo(LOG_SOURCE_SYSTEM, "Config: Loaded in %lu us", configLoadTime);
     I2CInit();
 
     struct BT_t bt = BTInit();
@@ -150,13 +158,45 @@ int main(void)
     PCM51XXStartup();
     // Reset the Boot flag in the EEPROM to indicate a valid boot
     ConfigSetBootloaderMode(0x00);
+    // Report the trace left by a trap, if any, and start recording
+    TraceInit();
 
     // Process events
     while (1) {
+        // The IBus has the tightest timing, so catch up on any bytes that
+        // arrived while we were busy. The batch limit keeps a flood of
+        // bus traffic from starving everything else.
+        uint8_t ibusBytes = 0;
+        TraceSetStage(TRACE_STAGE_IBUS);
+        do {
+            IBusProcess(&ibus);
+            ibusBytes++;
+        } while (CharQueueGetSize(&ibus.uart.rxQueue) > 0 &&
+                 ibusBytes < IBUS_RX_BATCH_SIZE
+        );
+        TraceSetStage(TRACE_STAGE_BT);
         BTProcess(&bt);
-        IBusProcess(&ibus);
+        // Scheduled tasks run within a time budget and carry over the rest
+        TraceSetStage(TRACE_STAGE_TASKS);
         TimerProcessScheduledTasks();
+        // Start queued EEPROM writes as the previous write cycle completes
+        TraceSetStage(TRACE_STAGE_EEPROM);
+        EEPROMProcess();
+        TraceSetStage(TRACE_STAGE_CLI);
         CLIProcess();
+        // Idle until the next interrupt if there is nothing left to do
+        if (CharQueueGetSize(&bt.uart.rxQueue) == 0 &&
+            CharQueueGetSize(&ibus.uart.rxQueue) == 0 &&
+            CharQueueGetSize(&systemUart.rxQueue) == 0 &&
+            ibus.txBufferWriteIdx == ibus.txBufferReadIdx &&
+            TimerGetNextTaskDeadline() >= TIMER_IDLE_MIN_DEADLINE
+        ) {
+            TraceSetStage(TRACE_STAGE_IDLE);
+            // Commit pending configuration writes before going idle
+            if (ConfigProcess() == 0) {
+                TimerIdle();
+            }
+        }
     }
 
     return 0;
@@ -166,6 +206,10 @@ int main(void)
 void TrapWait()
 {
     ON_LED = 0;
+    // The TX ISR cannot run from a trap, so send any queued log messages
+    // now and log synchronously from here on
+    LogSetSynchronous();
+    ConfigFlush();
     // Wait five seconds before resetting
     uint32_t sleepCount = 0;
     while (sleepCount <= 50000) {
@@ -179,6 +223,7 @@ void __attribute__ ((__interrupt__, auto_psv)) _AltOscillatorFail()
 {
     // Clear the trap flag
     INTCON1bits.OSCFAIL = 0;
+    TraceFreeze(CONFIG_TRAP_OSC);
     ConfigSetTrapIncrement(CONFIG_TRAP_OSC);
     TrapWait();
 }
@@ -187,6 +232,7 @@ void __attribute__ ((__interrupt__, auto_psv)) _AltAddressError()
 {
     // Clear the trap flag
     INTCON1bits.ADDRERR = 0;
+    TraceFreeze(CONFIG_TRAP_ADDR);
     ConfigSetTrapIncrement(CONFIG_TRAP_ADDR);
     TrapWait();
 }
@@ -195,6 +241,7 @@ void __attribute__ ((__interrupt__, auto_psv)) _AltStackError()
 {
     // Clear the trap flag
     INTCON1bits.STKERR = 0;
+    TraceFreeze(CONFIG_TRAP_STACK);
     ConfigSetTrapIncrement(CONFIG_TRAP_STACK);
     TrapWait();
 }
@@ -203,18 +250,21 @@ void __attribute__ ((__interrupt__, auto_psv)) _AltMathError()
 {
     // Clear the trap flag
     INTCON1bits.MATHERR = 0;
+    TraceFreeze(CONFIG_TRAP_MATH);
     ConfigSetTrapIncrement(CONFIG_TRAP_MATH);
     TrapWait();
 }
 
 void __attribute__ ((__interrupt__, auto_psv)) _AltNVMError()
 {
+    TraceFreeze(CONFIG_TRAP_NVM);
     ConfigSetTrapIncrement(CONFIG_TRAP_NVM);
     TrapWait();
 }
 
 void __attribute__ ((__interrupt__, auto_psv)) _AltGeneralError()
 {
+    TraceFreeze(CONFIG_TRAP_GEN);
     ConfigSetTrapIncrement(CONFIG_TRAP_GEN);
     TrapWait();
 }
@@ -320,6 +320,57 @@ void CLICommandBTBM83(char **msgBuf, uint8_t *cmdSuccess, uint8_t delimCount)
     }
 }
 
+/**
+ * CLICommandConfig()
+ *     Description:
+ *         Parse the "CONFIG" CLI Commands, which dump and load configuration
+ *         snapshots as hex, see utility/config_snapshot.py
+ *     Params:
+ *         char **msgBuf - The message buffer
+ *         uint8_t *cmdSuccess - A pointer to the command success flag
+ *         uint8_t delimCount - The number of parameters in the command
+ *     Returns:
+ *         void
+ */
+void CLICommandConfig(char **msgBuf, uint8_t *cmdSuccess, uint8_t delimCount)
+{
+    uint8_t snapshot[CONFIG_SNAPSHOT_SIZE];
+    uint8_t idx = 0;
+    if (UtilsStricmp(msgBuf[1], "DUMP") == 0 && delimCount == 2) {
+        char hex[(CONFIG_SNAPSHOT_SIZE * 2) + 1];
+        uint8_t size = ConfigGetSnapshot(snapshot);
+        for (idx = 0; idx < size; idx++) {
+            snprintf(&hex[idx * 2], 3, "%02X", snapshot[idx]);
+        }
+        LogRaw("Config: %s\r\n", hex);
+    } else if (UtilsStricmp(msgBuf[1], "LOAD") == 0 && delimCount == 3) {
+        uint16_t length = strlen(msgBuf[2]);
+        if (length % 2 != 0 || length > CONFIG_SNAPSHOT_SIZE * 2) {
+            LogRaw("Config: Invalid snapshot length\r\n");
+            return;
+        }
+        for (idx = 0; idx < length / 2; idx++) {
+            char byte[] = {msgBuf[2][idx * 2], msgBuf[2][(idx * 2) + 1], '\0'};
+            snapshot[idx] = UtilsStrToHex(byte);
+        }
+        uint8_t status = ConfigSetSnapshot(snapshot, length / 2);
+        if (status == CONFIG_SNAPSHOT_OK) {
+            LogLoadSources();
+            LogRaw("Config: Loaded %d bytes, REBOOT to apply\r\n", snapshot[2]);
+        } else if (status == CONFIG_SNAPSHOT_ERROR_CHECKSUM) {
+            LogRaw("Config: Invalid snapshot checksum\r\n");
+        } else if (status == CONFIG_SNAPSHOT_ERROR_VERSION) {
+            LogRaw("Config: Unsupported snapshot version %02X\r\n", snapshot[0]);
+        } else if (status == CONFIG_SNAPSHOT_ERROR_RANGE) {
+            LogRaw("Config: Snapshot range is not writable\r\n");
+        } else {
+            LogRaw("Config: Invalid snapshot length\r\n");
+        }
+    } else {
+        *cmdSuccess = 0;
+    }
+}
+
 /**
  * CLIEventBTBTMAddress()
  *     Description:
@@ -428,11 +479,11 @@ void CLIProcess()
             }
             if (UtilsStricmp(msgBuf[0], "BOOTLOADER") == 0) {
                 LogRaw("Rebooting into bootloader\r\n");
-                uint32_t now = TimerGetMillis();
-                // Wait 15ms before going into the bootloader
-                // so our message debug goes through to the CLI
-                while (TimerGetMillis() - now <= 15);
+                // Make sure our message goes through to the CLI before
+                // going into the bootloader
+                LogFlush();
                 ConfigSetBootloaderMode(0x01);
+                ConfigFlush();
                 UtilsReset();
             } else if (UtilsStricmp(msgBuf[0], "BT") == 0) {
                 if (UtilsStricmp(msgBuf[1], "AT") == 0) {
@@ -462,6 +513,8 @@ void CLIProcess()
                 } else {
                     CLICommandBTBM83(msgBuf, &cmdSuccess, delimCount);
                 }
+            } else if (UtilsStricmp(msgBuf[0], "CONFIG") == 0) {
+                CLICommandConfig(msgBuf, &cmdSuccess, delimCount);
             } else if (UtilsStricmp(msgBuf[0], "GET") == 0) {
                 if (UtilsStricmp(msgBuf[1], "BYTE") == 0 && delimCount == 3) {
                     uint8_t byte = UtilsStrToHex(msgBuf[2]);
@@ -473,11 +526,107 @@ void CLIProcess()
                     } else {
                         cmdSuccess = 0;
                     }
+                } else if (UtilsStricmp(msgBuf[1], "BT") == 0 &&
+                    cli.bt->type == BT_BTM_TYPE_BM83
+                ) {
+                    BM83FrameParser_t *parser = BM83GetFrameParser();
+                    LogRaw(
+                        "BM83 Bad Checksums: %lu, Trashed Bytes: %lu\r\n",
+                        parser->badChecksums,
+                        parser->trashedBytes
+                    );
+                    LogRaw(
+                        "BM83 Command Queue: %d\r\n",
+                        BM83CommandQueueGetDepth()
+                    );
+                    uint8_t idx = 0;
+                    BM83CommandStats_t *stats = BM83CommandQueueGetStats(idx);
+                    while (stats != 0) {
+                        uint32_t latencyAverage = 0;
+                        if (stats->completed > 0) {
+                            latencyAverage = stats->latencyTotal / stats->completed;
+                        }
+                        LogRaw(
+                            "    %02X: OK %u, Failed %u, Retries %u, "
+                            "Latency Last %u ms, Avg %lu ms, Max %u ms\r\n",
+                            stats->opcode,
+                            stats->completed,
+                            stats->failures,
+                            stats->retries,
+                            stats->latencyLast,
+                            latencyAverage,
+                            stats->latencyMax
+                        );
+                        stats = BM83CommandQueueGetStats(++idx);
+                    }
+                    BM83MetadataCacheStats_t *cache = BM83MetadataCacheGetStats();
+                    uint32_t lookups = cache->hits + cache->misses;
+                    uint32_t hitRate = 0;
+                    if (lookups > 0) {
+                        hitRate = (cache->hits * 100) / lookups;
+                    }
+                    LogRaw(
+                        "BM83 Metadata Cache: Hits %lu, Misses %lu (%lu%%), "
+                        "Track Hits %lu, Suppressed %lu\r\n",
+                        cache->hits,
+                        cache->misses,
+                        hitRate,
+                        cache->trackHits,
+                        cache->suppressed
+                    );
+                    LogRaw(
+                        "BM83 Track Change to Metadata: Last %u ms, Max %u ms\r\n",
+                        cli.bt->metadataLatencyLast,
+                        cli.bt->metadataLatencyMax
+                    );
+                } else if (UtilsStricmp(msgBuf[1], "BT") == 0) {
+                    BC127CommandStats_t *stats = BC127CommandQueueGetStats();
+                    uint32_t latencyAverage = 0;
+                    if (stats->completed > 0) {
+                        latencyAverage = stats->latencyTotal / stats->completed;
+                    }
+                    LogRaw(
+                        "BC127 Command Queue: %d (Peak %d)\r\n",
+                        BC127CommandQueueGetDepth(),
+                        stats->peak
+                    );
+                    LogRaw(
+                        "BC127 Commands: %lu, Errors: %lu, Timeouts: %lu, Dropped: %lu\r\n",
+                        stats->completed,
+                        stats->errors,
+                        stats->timeouts,
+                        stats->dropped
+                    );
+                    LogRaw(
+                        "BC127 Latency: Last %u ms, Avg %lu ms, Max %u ms\r\n",
+                        stats->latencyLast,
+                        latencyAverage,
+                        stats->latencyMax
+                    );
                 } else if (UtilsStricmp(msgBuf[1], "IBUS") == 0) {
                     IBusCommandDIAGetIdentity(cli.ibus, IBUS_DEVICE_GT);
                     IBusCommandDIAGetIdentity(cli.ibus, IBUS_DEVICE_RAD);
                 } else if (UtilsStricmp(msgBuf[1], "LCM") == 0) {
                     IBusCommandDIAGetIdentity(cli.ibus, IBUS_DEVICE_LCM);
+                } else if (UtilsStricmp(msgBuf[1], "EEPROM") == 0) {
+                    LogRaw("EEPROM Reads: %lu\r\n", EEPROMGetReadCount());
+                    LogRaw("EEPROM Reads/s: %u\r\n", EEPROMGetReadRate());
+                    LogRaw(
+                        "EEPROM Write Queue: %d (Peak %d)\r\n",
+                        EEPROMGetWriteQueueDepth(),
+                        EEPROMGetWriteQueuePeak()
+                    );
+                    LogRaw(
+                        "EEPROM Stalls: %lu (%lu us)\r\n",
+                        EEPROMGetStallCount(),
+                        EEPROMGetStallTime()
+                    );
+                    LogRaw(
+                        "Store: Bank %d, %d of %d records\r\n",
+                        StoreGetBank(),
+                        StoreGetRecordCount(),
+                        STORE_RECORD_COUNT - 1
+                    );
                 } else if (UtilsStricmp(msgBuf[1], "ERR") == 0) {
                     // Errors
                     LogRaw("Trap Counts: \r\n");
@@ -489,6 +638,22 @@ void CLIProcess()
                     LogRaw("    General Failures: %d\r\n", ConfigGetTrapCount(CONFIG_TRAP_GEN));
                     LogRaw("    Last Trap: %02x\r\n", ConfigGetTrapLast());
                     LogRaw("BC127 Boot Failures: %u\r\n", ConfigGetBC127BootFailures());
+                } else if (UtilsStricmp(msgBuf[1], "LOG") == 0) {
+                    LogRaw("Dropped Log Messages: %lu\r\n", LogGetDroppedMessages());
+                    char *sourceNames[] = {"BT", "IBUS", "SYS", "UI"};
+                    uint8_t source = 0;
+                    for (source = LOG_SOURCE_BT; source <= LOG_SOURCE_UI; source++) {
+                        LogSourceStats_t *stats = LogGetSourceStats(source);
+                        LogRaw(
+                            "    %s: Rate Limit %s, Rate Limited: %lu, Repeated: %lu\r\n",
+                            sourceNames[source - LOG_SOURCE_BT],
+                            LogRateLimitEnabled(source) == 1 ? "ON" : "OFF",
+                            stats->rateLimited,
+                            stats->repeated
+                        );
+                    }
+                } else if (UtilsStricmp(msgBuf[1], "TRACE") == 0) {
+                    TraceDump();
                 } else if (UtilsStricmp(msgBuf[1], "UI") == 0) {
                     uint8_t uiMode = ConfigGetUIMode();
                     if (uiMode == CONFIG_UI_CD53) {
@@ -556,6 +721,8 @@ void CLIProcess()
                     cmdSuccess = 0;
                 }
             } else if (UtilsStricmp(msgBuf[0], "REBOOT") == 0) {
+                LogFlush();
+                ConfigFlush();
                 UtilsReset();
             } else if (UtilsStricmp(msgBuf[0], "RESET") == 0) {
                 if (UtilsStricmp(msgBuf[1], "TRAPS") == 0) {
@@ -727,6 +894,10 @@ void CLIProcess()
                         system = CONFIG_DEVICE_LOG_SYSTEM;
                     } else if (UtilsStricmp(msgBuf[2], "UI") == 0) {
                         system = CONFIG_DEVICE_LOG_UI;
+                    } else if (UtilsStricmp(msgBuf[2], "US") == 0) {
+                        system = CONFIG_DEVICE_LOG_TIMESTAMP_US;
+                    } else if (UtilsStricmp(msgBuf[2], "BIN") == 0) {
+                        system = CONFIG_DEVICE_LOG_BINARY;
                     }
                     // Get the value
                     if (UtilsStricmp(msgBuf[3], "OFF") == 0) {
@@ -734,8 +905,21 @@ void CLIProcess()
                     } else if (UtilsStricmp(msgBuf[3], "ON") == 0) {
                         value = 1;
                     }
-                    if (system != 0xFF && value != 0xFF) {
+                    if (delimCount == 5 &&
+                        UtilsStricmp(msgBuf[3], "LIMIT") == 0 &&
+                        system <= CONFIG_DEVICE_LOG_UI
+                    ) {
+                        // Rate limiting is not persisted
+                        if (UtilsStricmp(msgBuf[4], "OFF") == 0) {
+                            LogSetRateLimit(system, 0);
+                        } else if (UtilsStricmp(msgBuf[4], "ON") == 0) {
+                            LogSetRateLimit(system, 1);
+                        } else {
+                            LogRaw("Invalid Parameters for SET LOG\r\n");
+                        }
+                    } else if (system != 0xFF && value != 0xFF) {
                         ConfigSetLog(system, value);
+                        LogLoadSources();
                     } else {
                         LogRaw("Invalid Parameters for SET LOG\r\n");
                     }
@@ -818,11 +1002,11 @@ void CLIProcess()
                 uint8_t vin[] = {0x00, 0x00, 0x00, 0x00, 0x00};
                 ConfigSetVehicleIdentity(vin);
                 // Reset all settings
-                uint8_t idx = CONFIG_SETTING_START_ADDRESS;
-                while (idx <= CONFIG_SETTING_END_ADDRESS) {
-                    ConfigSetSetting(idx, 0x00);
-                    idx++;
-                }
+                ConfigSetSettings(
+                    CONFIG_SETTING_START_ADDRESS,
+                    CONFIG_SETTING_END_ADDRESS,
+                    0x00
+                );
                 // Settings
                 // Enable Auto Power Off
                 ConfigSetSetting(CONFIG_SETTING_AUTO_POWEROFF, CONFIG_SETTING_ON);
@@ -834,6 +1018,8 @@ void CLIProcess()
                 ConfigSetSetting(CONFIG_SETTING_HFP, CONFIG_SETTING_ON);
                 ConfigSetSetting(CONFIG_SETTING_MIC_BIAS, CONFIG_SETTING_ON);
                 ConfigSetSetting(CONFIG_SETTING_MIC_GAIN, micGain);
+                // The log settings were reset along with everything else
+                LogLoadSources();
             } else if (UtilsStricmp(msgBuf[0], "TEST") == 0) {
                 int8_t status = 0x00;
                 uint8_t buffer = 0x00;
@@ -844,6 +1030,68 @@ void CLIProcess()
                     LogRaw("DAC: FAIL\r\n");
                 }
                 BM83CommandReadLocalBDAddress(cli.bt);
+            } else if (UtilsStricmp(msgBuf[0], "TIMER") == 0 && delimCount >= 2) {
+                if (UtilsStricmp(msgBuf[1], "STATS") == 0) {
+                    if (delimCount == 3 && UtilsStricmp(msgBuf[2], "RESET") == 0) {
+                        TimerResetTaskStats();
+                    } else {
+                        uint8_t taskCount = TimerGetScheduledTaskCount();
+                        uint8_t taskId;
+                        LogRaw(
+                            "Scheduled Tasks (Budget: %u us, Deferred Passes: %lu):\r\n",
+                            TIMER_PROCESS_BUDGET,
+                            TimerGetProcessDeferrals()
+                        );
+                        for (taskId = 0; taskId < taskCount; taskId++) {
+                            volatile TimerScheduledTask_t *t = TimerGetScheduledTask(taskId);
+                            if (t->task == 0) {
+                                continue;
+                            }
+                            uint32_t runTimeAverage = 0;
+                            if (t->stats.runCount > 0) {
+                                runTimeAverage = t->stats.runTimeTotal / t->stats.runCount;
+                            }
+                            LogRaw(
+                                "    %d. %s (%u ms)\r\n",
+                                taskId,
+                                t->name,
+                                t->interval
+                            );
+                            LogRaw(
+                                "        Runs: %lu Avg: %lu us Max: %u us Late: %u ms Overruns: %u (Budget: %u us)\r\n",
+                                t->stats.runCount,
+                                runTimeAverage,
+                                t->stats.runTimeMax,
+                                t->stats.lateMax,
+                                t->stats.overruns,
+                                t->budget
+                            );
+                        }
+                    }
+                } else if (UtilsStricmp(msgBuf[1], "IDLE") == 0) {
+                    if (delimCount == 3 && UtilsStricmp(msgBuf[2], "RESET") == 0) {
+                        TimerResetIdleStats();
+                    } else {
+                        TimerIdleStats_t *idleStats = TimerGetIdleStats();
+                        uint32_t elapsed = TimerGetMillis() - idleStats->resetTimestamp;
+                        uint8_t idlePercent = 0;
+                        if (elapsed >= 100) {
+                            uint32_t percent = idleStats->residency / (elapsed / 100);
+                            idlePercent = percent > 100 ? 100 : percent;
+                        }
+                        LogRaw("Idle Entries: %lu\r\n", idleStats->entries);
+                        LogRaw("Idle Residency: %lu ms of %lu ms (%d%%)\r\n", idleStats->residency, elapsed, idlePercent);
+                    }
+                } else if (UtilsStricmp(msgBuf[1], "BUDGET") == 0 && delimCount == 4) {
+                    uint8_t taskId = UtilsStrToInt(msgBuf[2]);
+                    if (TimerGetScheduledTask(taskId) != 0) {
+                        TimerSetTaskBudget(taskId, (uint16_t) strtol(msgBuf[3], 0, 10));
+                    } else {
+                        cmdSuccess = 0;
+                    }
+                } else {
+                    cmdSuccess = 0;
+                }
             } else if (UtilsStricmp(msgBuf[0], "VERSION") == 0) {
                 char version[9];
                 ConfigGetFirmwareVersionString(version);
@@ -878,9 +1126,15 @@ void CLIProcess()
                 LogRaw("    BT AT command> - Send raw AT command\r\n");
                 LogRaw("    BT DIAL <number> <name> - Dial a number and display name\r\n");
                 LogRaw("    BT REDIAL - Dial last number\r\n");
+                LogRaw("    CONFIG DUMP - Print a snapshot of the configuration\r\n");
+                LogRaw("    CONFIG LOAD <snapshot> - Apply a snapshot from CONFIG DUMP\r\n");
+                LogRaw("    GET BT - Get the BT command queue and frame counters\r\n");
                 LogRaw("    GET DAC - Get info from the PCM5122 DAC\r\n");
+                LogRaw("    GET EEPROM - Get the EEPROM read counters\r\n");
                 LogRaw("    GET ERR - Get the Error counter\r\n");
                 LogRaw("    GET IBUS - Get debug info from the IBus\r\n");
+                LogRaw("    GET LOG - Get the logging counters\r\n");
+                LogRaw("    GET TRACE - Show the most recent IBus and BT events\r\n");
                 LogRaw("    GET UI - Get the current UI Mode\r\n");
                 LogRaw("    GET I2S - Read the WM8804 INT/SPD Status registers\r\n");
                 LogRaw("    GET VIN - Read the stored vehicle VIN\r\n");
@@ -892,6 +1146,9 @@ void CLIProcess()
                 LogRaw("    SET DSP INPUT ANALOG/DIGITAL/DEFAULT - Set the CD Changer DSP input\r\n");
                 LogRaw("    SET IGN ON/OFF/ALWAYSON - Send the ignition status message or configure the BlueBus to assume the ignition is always on\r\n");
                 LogRaw("    SET LOG x ON/OFF - Change logging for x (BT, IBUS, SYS, UI)\r\n");
+                LogRaw("    SET LOG x LIMIT ON/OFF - Rate limit and collapse repeated logs for x\r\n");
+                LogRaw("    SET LOG US ON/OFF - Use microsecond timestamps for logs\r\n");
+                LogRaw("    SET LOG BIN ON/OFF - Send binary logs, see utility/log_decoder.py\r\n");
                 LogRaw("    SET PWROFF ON/OFF - Enable or disable auto power off\r\n");
                 LogRaw("    SET TEL ON/OFF - Enable/Disable output as the TCU\r\n");
                 LogRaw("    SET TIME HH MM - Set the IKE Time\r\n");
@@ -901,6 +1158,9 @@ void CLIProcess()
                 LogRaw("        x = 3. MID (Multi-Info Display)\r\n");
                 LogRaw("        x = 4. BMBT / MID\r\n");
                 LogRaw("        x = 5. Business Navigation (MIR)\r\n");
+                LogRaw("    TIMER STATS - Show the runtime stats for the scheduled tasks. TIMER STATS RESET clears them\r\n");
+                LogRaw("    TIMER IDLE - Show how often and how long the CPU has idled. TIMER IDLE RESET clears it\r\n");
+                LogRaw("    TIMER BUDGET x us - Set the execution budget of task x in microseconds (0 to disable)\r\n");
                 LogRaw("    RESTORE - Fully Reset the BlueBus and BC127 to factory defaults\r\n");
                 LogRaw("    VERSION - Get the BlueBus Hardware/Software Versions\r\n");
             } else {
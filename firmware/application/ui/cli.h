@@ -19,6 +19,7 @@
 #include "../lib/ibus.h"
 #include "../lib/pcm51xx.h"
 #include "../lib/timer.h"
+#include "../lib/trace.h"
 #include "../lib/uart.h"
 
 // Banner timeout is in seconds
@@ -48,6 +49,7 @@ typedef struct CLI_t {
 void CLIInit(UART_t *, BT_t *, IBus_t *);
 void CLICommandBTBC127(char **, uint8_t *, uint8_t);
 void CLICommandBTBM83(char **, uint8_t *, uint8_t);
+void CLICommandConfig(char **, uint8_t *, uint8_t);
 void CLIEventBTBTMAddress(void *, uint8_t *);
 void CLIProcess();
 void CLITimerTerminalReady(void *);
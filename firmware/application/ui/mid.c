@@ -321,38 +321,47 @@ void MIDBTDeviceDisconnected(void *ctx, unsigned char *tmp)
 void MIDBTMetadataUpdate(void *ctx, unsigned char *tmp)
 {
     MIDContext_t *context = (MIDContext_t *) ctx;
+    // Redraw everything unless we were told which fields changed
+    uint8_t fields = BT_METADATA_FIELD_ALL;
+    if (tmp != 0x00) {
+        fields = tmp[0];
+    }
     if (context->mode == MID_MODE_ACTIVE &&
         strlen(context->bt->title) > 0 &&
         ConfigGetSetting(CONFIG_SETTING_METADATA_MODE) != MID_SETTING_METADATA_MODE_OFF)
     {
-        memset(context->mainText, 0, sizeof(context->mainText));
         char text[UTILS_DISPLAY_TEXT_SIZE] = {0};
 
         uint8_t mid_button = MID_BUTTON_ONE_L;
 
         char artist[4];
 
-        for (int i = 0; i < 32; i+=4)
-        {
-            for (int j = 0; j < 4; j++)
+        // The artist is written to the buttons
+        if ((fields & BT_METADATA_FIELD_ARTIST) != 0) {
+            for (int i = 0; i < 32; i+=4)
             {
-                if (strlen(context->bt->artist+i+j) > 0)
-                {
-                    artist[j] = context->bt->artist[i+j];
-                }
-                else
+                for (int j = 0; j < 4; j++)
                 {
-                    artist[j] = ' ';
+                    if (strlen(context->bt->artist+i+j) > 0)
+                    {
+                        artist[j] = context->bt->artist[i+j];
+                    }
+                    else
+                    {
+                        artist[j] = ' ';
+                    }
                 }
+                IBusCommandMIDMenuWriteSingle(context->ibus, mid_button, artist);
+                mid_button++;
             }
-            IBusCommandMIDMenuWriteSingle(context->ibus, mid_button, artist);
-            mid_button++;
         }
 
-        snprintf(text, UTILS_DISPLAY_TEXT_SIZE, "%s", context->bt->title);
-
-        MIDSetMainDisplayText(context, text, 3000 / MID_DISPLAY_SCROLL_SPEED);
-        TimerTriggerScheduledTask(context->displayUpdateTaskId);
+        if ((fields & BT_METADATA_FIELD_TITLE) != 0) {
+            memset(context->mainText, 0, sizeof(context->mainText));
+            snprintf(text, UTILS_DISPLAY_TEXT_SIZE, "%s", context->bt->title);
+            MIDSetMainDisplayText(context, text, 3000 / MID_DISPLAY_SCROLL_SPEED);
+            TimerTriggerScheduledTask(context->displayUpdateTaskId);
+        }
     }
 }
 
@@ -36,11 +36,7 @@ uint8_t UpgradeProcess(BT_t *bt, IBus_t *ibus)
         unsigned char vin[] = {0x00, 0x00, 0x00, 0x00, 0x00};
         ConfigSetVehicleIdentity(vin);
         // Reset all settings
-        uint8_t idx = CONFIG_SETTING_START_ADDRESS;
-        while (idx <= 0x50) {
-            ConfigSetSetting(idx, 0x00);
-            idx++;
-        }
+        ConfigSetSettings(CONFIG_SETTING_START_ADDRESS, 0x50, 0x00);
         // Settings
         // -10dB Gain for the DAC
         ConfigSetSetting(CONFIG_SETTING_DAC_AUDIO_VOL, 0x44);
@@ -99,6 +95,7 @@ uint8_t UpgradeProcess(BT_t *bt, IBus_t *ibus)
         ConfigSetSetting(CONFIG_SETTING_IGN_ALWAYS_ON, ConfigGetSetting(0x1C));
         // Reset to logging to all off
         ConfigSetSetting(CONFIG_SETTING_LOG, 0x01);
+        LogLoadSources();
         LogRaw("Ran Upgrade 1.1.17\r\n");
     }
     // Changes in version 1.1.18
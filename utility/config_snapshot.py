@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Create and apply BlueBus configuration snapshots over the CLI, instead of
+setting every option with its own SET command:
+
+    ./config_snapshot.py dump --port /dev/ttyUSB0 -o car.cfg
+    ./config_snapshot.py load --port /dev/ttyUSB0 car.cfg
+    ./config_snapshot.py show car.cfg
+
+A snapshot holds a version byte, the start address and length of the
+configuration it covers, the configuration bytes and an XOR checksum. It is
+stored as hex, or as raw bytes with --binary. The logs must be in text mode
+(SET LOG BIN OFF) while the tool is used.
+"""
+import sys
+
+from argparse import ArgumentParser
+from time import time
+
+CONFIG_SNAPSHOT_VERSION = 0x01
+CONFIG_SNAPSHOT_HEADER_SIZE = 3
+# The user configuration, which starts after the vehicle data (0x0F - 0x19)
+CONFIG_SNAPSHOT_START_ADDRESS = 0x1A
+CONFIG_SNAPSHOT_END_ADDRESS = 0x70
+RESPONSE_PREFIX = 'Config: '
+TIMEOUT = 5
+
+
+def checksum(data):
+    """Return the XOR of all bytes"""
+    value = 0
+    for byte in data:
+        value ^= byte
+    return value
+
+
+def validate(snapshot):
+    """Raise a ValueError if the snapshot is not well formed"""
+    if len(snapshot) < CONFIG_SNAPSHOT_HEADER_SIZE + 1:
+        raise ValueError('Snapshot is too short')
+    if len(snapshot) != CONFIG_SNAPSHOT_HEADER_SIZE + snapshot[2] + 1:
+        raise ValueError('Snapshot length does not match its header')
+    if checksum(snapshot) != 0:
+        raise ValueError('Invalid snapshot checksum')
+    if snapshot[0] != CONFIG_SNAPSHOT_VERSION:
+        raise ValueError('Unsupported snapshot version %02X' % snapshot[0])
+    if snapshot[2] == 0 or snapshot[1] + snapshot[2] - 1 > CONFIG_SNAPSHOT_END_ADDRESS:
+        raise ValueError('Snapshot covers addresses beyond the configuration')
+
+
+def trim(snapshot):
+    """Drop the vehicle data that older snapshots start with, so that the VIN
+    and vehicle detection of the car it was taken from are not loaded"""
+    start = snapshot[1]
+    if start >= CONFIG_SNAPSHOT_START_ADDRESS:
+        return snapshot
+    skip = CONFIG_SNAPSHOT_START_ADDRESS - start
+    data = snapshot[CONFIG_SNAPSHOT_HEADER_SIZE + skip:-1]
+    if not data:
+        raise ValueError('Snapshot only holds vehicle data')
+    trimmed = bytes([snapshot[0], CONFIG_SNAPSHOT_START_ADDRESS, len(data)]) + data
+    return trimmed + bytes([checksum(trimmed)])
+
+
+def read_snapshot(filename):
+    """Read a snapshot stored either as hex or as raw bytes"""
+    with open(filename, 'rb') as snapshot_file:
+        data = snapshot_file.read()
+    try:
+        snapshot = bytes.fromhex(data.decode('ascii').strip())
+    except (UnicodeDecodeError, ValueError):
+        snapshot = data
+    validate(snapshot)
+    return snapshot
+
+
+def command(port, text):
+    """Send a CLI command and return the first `Config: ` response"""
+    port.reset_input_buffer()
+    port.write(text.encode('ascii') + b'\r')
+    deadline = time() + TIMEOUT
+    while time() < deadline:
+        line = port.readline().decode('ascii', errors='replace').strip()
+        if line.startswith(RESPONSE_PREFIX):
+            return line[len(RESPONSE_PREFIX):]
+    raise TimeoutError('No response to %s' % ' '.join(text.split(' ')[0:2]))
+
+
+def show(snapshot):
+    """Print the configuration bytes of a snapshot by address"""
+    start = snapshot[1]
+    data = snapshot[CONFIG_SNAPSHOT_HEADER_SIZE:-1]
+    print('Version %02X, %d bytes from 0x%02X' % (snapshot[0], len(data), start))
+    for offset in range(0, len(data), 16):
+        row = ' '.join('%02X' % byte for byte in data[offset:offset + 16])
+        print('    %02X: %s' % (start + offset, row))
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description='BlueBus configuration snapshots')
+    commands = parser.add_subparsers(dest='command')
+    dump_parser = commands.add_parser('dump', help='Read a snapshot')
+    dump_parser.add_argument('--port', required=True, help='Serial port')
+    dump_parser.add_argument('--baud', type=int, default=115200)
+    dump_parser.add_argument('--binary', action='store_true')
+    dump_parser.add_argument('-o', '--output', help='Snapshot file to write')
+    load_parser = commands.add_parser('load', help='Apply a snapshot')
+    load_parser.add_argument('--port', required=True, help='Serial port')
+    load_parser.add_argument('--baud', type=int, default=115200)
+    load_parser.add_argument('file', help='Snapshot file to apply')
+    show_parser = commands.add_parser('show', help='Print a snapshot')
+    show_parser.add_argument('file', help='Snapshot file to print')
+    args = parser.parse_args()
+
+    if args.command == 'show':
+        show(read_snapshot(args.file))
+    elif args.command in ('dump', 'load'):
+        from serial import Serial
+        port = Serial(args.port, args.baud, timeout=1)
+        if args.command == 'dump':
+            snapshot = bytes.fromhex(command(port, 'CONFIG DUMP'))
+            validate(snapshot)
+            if args.binary:
+                output = snapshot
+            else:
+                output = (snapshot.hex().upper() + '\n').encode('ascii')
+            if args.output:
+                with open(args.output, 'wb') as snapshot_file:
+                    snapshot_file.write(output)
+            else:
+                sys.stdout.buffer.write(output)
+        else:
+            snapshot = trim(read_snapshot(args.file))
+            response = command(port, 'CONFIG LOAD ' + snapshot.hex().upper())
+            print(response)
+            if not response.startswith('Loaded'):
+                sys.exit(1)
+    else:
+        parser.print_help()
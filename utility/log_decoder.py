@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""
+Decode BlueBus binary logs (SET LOG BIN ON) back into the text log format,
+so that the output can be read directly or fed to log_parser.pl.
+
+Binary log frames carry the address of the format string instead of the
+formatted text. The format strings are taken from the firmware build:
+
+    ./log_decoder.py table --hex BlueBus.hex --map BlueBus.map -o table.json
+    ./log_decoder.py decode --table table.json session.log > session.txt
+    ./log_decoder.py decode --table table.json --port /dev/ttyUSB0
+
+Anything outside of a valid frame (CLI output, raw hex dumps) is passed
+through untouched.
+"""
+import json
+import re
+import sys
+
+from argparse import ArgumentParser
+from intelhex import IntelHex
+
+LOG_BINARY_FRAME_START = 0x01
+LOG_LEVEL_NONE = 4
+LOG_LEVEL_NAMES = ['DEBUG', 'INFO', 'WARNING', 'ERROR']
+# Data space window that constants are mapped into (PSV)
+PSV_WINDOW = 0x8000
+FORMAT_SPEC = re.compile(r'%([-+ #0]*[0-9]*(?:\.[0-9]+)?)([hl]*)([a-zA-Z%])')
+
+
+def read_const_section(filename):
+    """Return the program memory address and length of `.const` from a map"""
+    with open(filename, 'r', errors='replace') as map_file:
+        for line in map_file:
+            match = re.match(r'^\.const\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)', line)
+            if match:
+                return int(match.group(1), 16), int(match.group(2), 16)
+    raise ValueError('No .const section found in %s' % filename)
+
+
+def build_table(hex_filename, map_filename):
+    """Map the data space address of every string in `.const` to the string"""
+    memory_map = IntelHex(hex_filename)
+    start, length = read_const_section(map_filename)
+    table = {}
+    current = bytearray()
+    current_address = None
+    # Each program word holds two bytes of PSV data in its lower 16 bits
+    for address in range(start, start + length, 2):
+        for offset in range(2):
+            data_address = PSV_WINDOW | ((address & 0x7FFF) + offset)
+            value = memory_map[(address << 1) + offset]
+            if current_address is None:
+                current_address = data_address
+            if value == 0:
+                if current:
+                    table[current_address] = current.decode('latin-1')
+                current = bytearray()
+                current_address = None
+            else:
+                current.append(value)
+    return table
+
+
+def lookup(table, identifier):
+    """Find a format string, allowing for strings merged into longer ones"""
+    if identifier in table:
+        return table[identifier]
+    for address, fmt in table.items():
+        if address < identifier < address + len(fmt):
+            return fmt[identifier - address:]
+    return None
+
+
+def format_message(fmt, payload):
+    """Rebuild the text for a format string from its encoded arguments"""
+    output = []
+    idx = 0
+    last = 0
+    for spec in FORMAT_SPEC.finditer(fmt):
+        output.append(fmt[last:spec.start()])
+        last = spec.end()
+        flags, modifier, conversion = spec.groups()
+        if conversion == '%':
+            output.append('%')
+            continue
+        if conversion == 's':
+            end = payload.index(0, idx)
+            value = payload[idx:end].decode('latin-1')
+            idx = end + 1
+        else:
+            size = {'': 2, 'h': 2, 'l': 4}.get(modifier, 8)
+            value = int.from_bytes(payload[idx:idx + size], 'little')
+            idx += size
+            if conversion in 'di' and value >= 1 << (size * 8 - 1):
+                value -= 1 << (size * 8)
+            if conversion == 'u':
+                conversion = 'd'
+        output.append(('%' + flags + conversion) % value)
+    output.append(fmt[last:])
+    return ''.join(output)
+
+
+def decode_frame(table, data):
+    """Decode a frame, returning the text and its size or (None, 0)"""
+    if len(data) < 3:
+        return None, 0
+    length = data[1]
+    if len(data) < length + 3:
+        return None, 0
+    checksum = 0
+    for value in data[1:length + 2]:
+        checksum ^= value
+    if checksum != data[length + 2]:
+        return None, 0
+    level = data[2]
+    fmt = lookup(table, data[3] | (data[4] << 8))
+    if fmt is None or level > LOG_LEVEL_NONE:
+        return None, 0
+    payload = data[5:length + 2]
+    try:
+        if level == LOG_LEVEL_NONE:
+            text = format_message(fmt, payload)
+        else:
+            timestamp = int.from_bytes(payload[0:4], 'little')
+            text = '[%d] %s: %s\r\n' % (
+                timestamp,
+                LOG_LEVEL_NAMES[level],
+                format_message(fmt, payload[4:])
+            )
+    except (ValueError, TypeError):
+        return None, 0
+    return text.encode('latin-1'), length + 3
+
+
+def decode(table, read, write):
+    """Decode a byte stream, passing through anything that is not a frame"""
+    buffer = bytearray()
+    while True:
+        chunk = read()
+        if not chunk:
+            break
+        buffer.extend(chunk)
+        while buffer:
+            start = buffer.find(LOG_BINARY_FRAME_START)
+            if start == -1:
+                write(bytes(buffer))
+                buffer.clear()
+                break
+            if start > 0:
+                write(bytes(buffer[:start]))
+                del buffer[:start]
+            # Wait for the rest of the frame before deciding
+            if len(buffer) < 3 or len(buffer) < buffer[1] + 3:
+                break
+            text, size = decode_frame(table, buffer)
+            if text is None:
+                # Not a frame, so treat the start byte as text and resync
+                write(bytes(buffer[:1]))
+                del buffer[:1]
+            else:
+                write(text)
+                del buffer[:size]
+    if buffer:
+        write(bytes(buffer))
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description='BlueBus binary log decoder')
+    commands = parser.add_subparsers(dest='command')
+    table_parser = commands.add_parser('table', help='Generate the format table')
+    table_parser.add_argument('--hex', required=True, help='Firmware hex file')
+    table_parser.add_argument('--map', required=True, help='Firmware map file')
+    table_parser.add_argument('-o', '--output', help='Table file to write')
+    decode_parser = commands.add_parser('decode', help='Decode a binary log')
+    decode_parser.add_argument('--table', required=True, help='Format table')
+    decode_parser.add_argument('--port', help='Serial port to read from')
+    decode_parser.add_argument('--baud', type=int, default=115200)
+    decode_parser.add_argument('file', nargs='?', help='Log file to read')
+    args = parser.parse_args()
+
+    if args.command == 'table':
+        table = build_table(args.hex, args.map)
+        output = json.dumps(
+            {'0x%04X' % address: fmt for address, fmt in sorted(table.items())},
+            indent=1
+        )
+        if args.output:
+            with open(args.output, 'w') as table_file:
+                table_file.write(output)
+        else:
+            print(output)
+    elif args.command == 'decode':
+        with open(args.table, 'r') as table_file:
+            table = {int(k, 16): v for k, v in json.load(table_file).items()}
+        out = sys.stdout.buffer
+
+        def write(data):
+            out.write(data)
+            out.flush()
+
+        if args.port:
+            from serial import Serial
+            port = Serial(args.port, args.baud, timeout=1)
+
+            def read_port():
+                data = b''
+                while not data:
+                    data = port.read(port.in_waiting or 1)
+                return data
+
+            try:
+                decode(table, read_port, write)
+            except KeyboardInterrupt:
+                pass
+        elif args.file:
+            with open(args.file, 'rb') as log_file:
+                decode(table, lambda: log_file.read(4096), write)
+        else:
+            decode(table, lambda: sys.stdin.buffer.read1(4096), write)
+    else:
+        parser.print_help()